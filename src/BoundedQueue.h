@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+
+/// @brief Fixed-capacity blocking queue used to hand items from one pipeline stage to the next.
+/**
+ * Each queue connects exactly one producing stage to one consuming stage. push() blocks while the queue is full,
+ * which applies backpressure to the upstream stage instead of letting work pile up, and pop() blocks while it is
+ * empty. close() wakes both sides so the stages can shut down.
+ *
+ * @tparam T The stored item type. It must be movable.
+ * @file BoundedQueue.h
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /// @brief Constructor sets the maximum number of queued items
+    /**
+     * @param capacity Maximum number of items held before push() blocks (minimum 1).
+     */
+    explicit BoundedQueue(std::size_t capacity = 2)
+        : maxItems(capacity > 0 ? capacity : 1) {
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /// @brief Append an item, waiting for room if the queue is full
+    /**
+     * @param item The item to append. It is moved into the queue.
+     * @return true if the item was queued, false if the queue was closed.
+     */
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]() { return closed || items.size() < maxItems; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /// @brief Take the oldest item, waiting for one if the queue is empty
+    /**
+     * @param out Receives the item on success.
+     * @return true if an item was taken, false once the queue is closed and drained.
+     */
+    bool pop(T& out) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        out = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    /// @brief Wake both sides; further pushes fail and pops drain what is left
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    /// @brief Discard any leftover items and accept pushes again
+    void reopen() {
+        std::lock_guard<std::mutex> lock(mutex);
+        items.clear();
+        closed = false;
+    }
+
+    /// @brief Number of items currently queued
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+
+private:
+    std::size_t maxItems;
+    std::deque<T> items;
+    bool closed = false;
+    mutable std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+};
@@ -0,0 +1,112 @@
+#include "CameraChannel.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+/**
+ * @brief One camera's complete recognition chain: capture, pipeline and voting state.
+ * @file CameraChannel.cpp
+ */
+
+/// @brief Read the camera list from a CSV file
+/**
+ * @param csvPath Path to cameras.csv. Each non-empty line is name,source,door; lines starting with '#' are ignored.
+ *                The source is a camera index or the path of a recording to replay.
+ * @return The configured cameras, in file order. Empty if the file cannot be read.
+ *
+ * Lines without a source are reported and skipped.
+ */
+std::vector<CameraConfig> loadCameraConfigs(const std::string& csvPath) {
+    std::vector<CameraConfig> cameras;
+    std::ifstream file(csvPath);
+    if (!file.is_open()) {
+        std::cerr << "Error opening cameras file: " << csvPath << std::endl;
+        return cameras;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::stringstream fields(line);
+        CameraConfig camera;
+        std::getline(fields, camera.name, ',');
+        std::getline(fields, camera.source, ',');
+        std::getline(fields, camera.door, ',');
+        if (camera.source.empty()) {
+            std::cerr << "Warning: Skipping camera line without a source: " << line << std::endl;
+            continue;
+        }
+        cameras.push_back(camera);
+    }
+    return cameras;
+}
+
+/// @brief Constructor loads the channel's detector and binds it to the shared recognizer
+/**
+ * @param config The camera to open and the door it guards.
+ * @param detectorConfig Path to detector.yml, which selects this channel's detector backend.
+ * @param rootDir Directory that model paths in detector.yml are relative to.
+ * @param recognizer Trained recognizer shared by all channels.
+ */
+CameraChannel::CameraChannel(CameraConfig config, const std::string& detectorConfig, const std::string& rootDir,
+    std::shared_ptr<const FaceRecognizerWrapper> recognizer)
+    : cameraConfig(std::move(config)),
+      pipeline(detector, recognizer) {
+    voter.setReferenceDistance(recognizer->getGallery()->acceptThreshold());
+    detector.loadConfig(detectorConfig, rootDir);
+    pipeline.setPreprocessParams(loadPreprocessConfig(rootDir + "/textfiles/preprocess.yml"));
+    pipeline.setRenderEnabled(false);
+}
+
+/// @brief Destructor stops the channel
+CameraChannel::~CameraChannel() {
+    stop();
+}
+
+/// @brief Open the camera and start recognizing
+/**
+ * @param onDecision Function receiving this camera's decisions.
+ * @param replay How the source is paced when it is a recording.
+ * @return true if the camera opened, false otherwise.
+ *
+ * Accepted predictions are voted on per track by this channel's own voter; every decision is passed to onDecision.
+ */
+bool CameraChannel::start(DecisionCallback onDecision, ReplayMode replay) {
+    pipeline.setResultCallback([this, onDecision](FrameResult&& result) {
+        for (const auto& face : result.faces) {
+            VoteDecision decision;
+            if (face.accepted && voter.addVote(face.trackId, face.label, face.confidence, face.name, decision) &&
+                onDecision) {
+                onDecision(cameraConfig, decision);
+            }
+        }
+        voter.endFrame();
+    });
+    if (!grabber.start(FrameSource::create(cameraConfig.source), replay)) {
+        return false;
+    }
+    pipeline.start(grabber.frames());
+    return true;
+}
+
+/// @brief Stop the pipeline and release the camera
+void CameraChannel::stop() {
+    pipeline.stop();
+    grabber.stop();
+}
+
+/// @brief The camera this channel reads from
+const CameraConfig& CameraChannel::config() const {
+    return cameraConfig;
+}
+
+/// @brief Whether the channel's recording has been replayed and fully processed
+bool CameraChannel::isFinished() const {
+    return pipeline.isFinished();
+}
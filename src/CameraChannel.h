@@ -0,0 +1,85 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FaceDetector.h"
+#include "FaceRecognizerWrapper.h"
+#include "FrameGrabber.h"
+#include "RecognitionPipeline.h"
+#include "TemporalVoter.h"
+
+
+/// @brief A named camera and the door it guards, as listed in cameras.csv
+struct CameraConfig {
+    std::string name;          ///< Name used in logs and decisions, e.g. "Lobby"
+    std::string source = "0";  ///< Camera index, video file or image directory, see FrameSource::create
+    std::string door;          ///< Door number this camera controls, compared with the door field of names.csv
+};
+
+
+/// @brief Read the camera list from a CSV file
+/**
+ * @param csvPath Path to cameras.csv. Each non-empty line is name,source,door; lines starting with '#' are ignored.
+ *                The source is a camera index or the path of a recording to replay.
+ * @return The configured cameras, in file order. Empty if the file cannot be read.
+ */
+std::vector<CameraConfig> loadCameraConfigs(const std::string& csvPath);
+
+
+/// @brief One camera's complete recognition chain: capture, pipeline and voting state.
+/**
+ * Each channel owns its own frame grabber, face detector, recognition pipeline and temporal voter, so cameras are
+ * processed independently on their own threads and one person's votes never mix with another camera's. The
+ * trained recognizer is shared: every channel holds the same read-only model, so memory and startup cost grow
+ * with the number of enrolled identities, not with the number of cameras.
+ *
+ * @file CameraChannel.h
+ */
+class CameraChannel {
+public:
+    /// Function receiving every decision this camera makes, called on the channel's render thread
+    using DecisionCallback = std::function<void(const CameraConfig&, const VoteDecision&)>;
+
+    /// @brief Constructor loads the channel's detector and binds it to the shared recognizer
+    /**
+     * @param config The camera to open and the door it guards.
+     * @param detectorConfig Path to detector.yml, which selects this channel's detector backend.
+     * @param rootDir Directory that model paths in detector.yml are relative to.
+     * @param recognizer Trained recognizer shared by all channels.
+     */
+    CameraChannel(CameraConfig config, const std::string& detectorConfig, const std::string& rootDir,
+        std::shared_ptr<const FaceRecognizerWrapper> recognizer);
+
+    /// @brief Destructor stops the channel
+    ~CameraChannel();
+
+    CameraChannel(const CameraChannel&) = delete;
+    CameraChannel& operator=(const CameraChannel&) = delete;
+
+    /// @brief Open the camera and start recognizing
+    /**
+     * @param onDecision Function receiving this camera's decisions.
+     * @param replay How the source is paced when it is a recording.
+     * @return true if the camera opened, false otherwise.
+     */
+    bool start(DecisionCallback onDecision, ReplayMode replay = ReplayMode::Realtime);
+
+    /// @brief Stop the pipeline and release the camera
+    void stop();
+
+    /// @brief The camera this channel reads from
+    const CameraConfig& config() const;
+
+    /// @brief Whether the channel's recording has been replayed and fully processed
+    bool isFinished() const;
+
+private:
+    CameraConfig cameraConfig;
+    FaceDetector detector;
+    TemporalVoter voter;
+    FrameGrabber grabber;
+    RecognitionPipeline pipeline;
+};
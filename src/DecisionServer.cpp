@@ -0,0 +1,112 @@
+#include "DecisionServer.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @brief Broadcasts recognition decisions to local clients over a Unix domain socket.
+ * @file DecisionServer.cpp
+ */
+
+/// @brief Destructor closes every client and removes the socket file
+DecisionServer::~DecisionServer() {
+    stop();
+}
+
+/// @brief Bind the socket and start accepting clients
+/**
+ * @param socketPath Filesystem path of the socket. A stale socket file at that path is replaced.
+ * @return true if the server is listening, false otherwise.
+ */
+bool DecisionServer::start(const std::string& socketPath) {
+    stop();
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: socket path is too long: " << socketPath << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Error creating socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    ::unlink(socketPath.c_str());
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listenFd, 8) < 0) {
+        std::cerr << "Error listening on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    path = socketPath;
+    running = true;
+    acceptThread = std::thread(&DecisionServer::acceptLoop, this);
+    return true;
+}
+
+/// @brief Stop accepting clients, disconnect everyone and remove the socket file
+void DecisionServer::stop() {
+    running = false;
+    if (acceptThread.joinable()) {
+        acceptThread.join();
+    }
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        listenFd = -1;
+        ::unlink(path.c_str());
+    }
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    for (int client : clients) {
+        ::close(client);
+    }
+    clients.clear();
+}
+
+/// @brief Send one line to every connected client
+/**
+ * @param line Text to send, without the trailing newline.
+ *
+ * Writes are non-blocking; a client whose connection failed or whose buffer is full is disconnected rather than
+ * allowed to stall the recognition threads.
+ */
+void DecisionServer::broadcast(const std::string& line) {
+    std::string message = line + "\n";
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    for (auto it = clients.begin(); it != clients.end();) {
+        ssize_t sent = ::send(*it, message.data(), message.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent != static_cast<ssize_t>(message.size())) {
+            ::close(*it);
+            it = clients.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/// @brief Accept clients until the server is stopped
+/**
+ * Polls with a short timeout so that stop() is noticed without having to interrupt a blocking accept().
+ */
+void DecisionServer::acceptLoop() {
+    while (running) {
+        pollfd listener{listenFd, POLLIN, 0};
+        if (::poll(&listener, 1, 200) <= 0 || !(listener.revents & POLLIN)) {
+            continue;
+        }
+        int client = ::accept(listenFd, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        clients.push_back(client);
+    }
+}
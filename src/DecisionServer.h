@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/// @brief Broadcasts recognition decisions to local clients over a Unix domain socket.
+/**
+ * The server listens on a SOCK_STREAM Unix socket and accepts any number of clients on a background thread.
+ * Every decision is written to all connected clients as one line of text; clients that have gone away are
+ * dropped on the next write. Clients only ever read, the server never waits on them.
+ *
+ * @file DecisionServer.h
+ */
+class DecisionServer {
+public:
+    DecisionServer() = default;
+
+    /// @brief Destructor closes every client and removes the socket file
+    ~DecisionServer();
+
+    DecisionServer(const DecisionServer&) = delete;
+    DecisionServer& operator=(const DecisionServer&) = delete;
+
+    /// @brief Bind the socket and start accepting clients
+    /**
+     * @param socketPath Filesystem path of the socket. A stale socket file at that path is replaced.
+     * @return true if the server is listening, false otherwise.
+     */
+    bool start(const std::string& socketPath);
+
+    /// @brief Stop accepting clients, disconnect everyone and remove the socket file
+    void stop();
+
+    /// @brief Send one line to every connected client
+    /**
+     * @param line Text to send, without the trailing newline.
+     */
+    void broadcast(const std::string& line);
+
+private:
+    void acceptLoop();
+
+    std::string path;
+    int listenFd = -1;
+    std::atomic<bool> running{false};
+    std::thread acceptThread;
+    std::mutex clientsMutex;
+    std::vector<int> clients;
+};
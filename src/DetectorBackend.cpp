@@ -0,0 +1,142 @@
+#include "DetectorBackend.h"
+#include <iostream>
+#include <utility>
+
+/**
+ * @brief Face detection backends: Haar and LBP cascades, and a CPU DNN detector.
+ * @file DetectorBackend.cpp
+ */
+
+namespace {
+
+/// Input size of the res10 SSD face network
+const cv::Size kDnnInputSize(300, 300);
+
+/// Mean BGR values the res10 network was trained with
+const cv::Scalar kDnnMean(104.0, 177.0, 123.0);
+
+}
+
+/// @brief Constructor records which kind of cascade this is
+/**
+ * @param name "haar" or "lbp", reported by name().
+ */
+CascadeBackend::CascadeBackend(std::string name)
+    : backendName(std::move(name)) {
+}
+
+/// @brief Load the cascade XML file
+/**
+ * @param cascadePath Path to the cascade XML file.
+ * @return true if the cascade was loaded successfully, false otherwise.
+ */
+bool CascadeBackend::load(const std::string& cascadePath) {
+    if (!cascade.load(cascadePath)) {
+        std::cerr << "Error loading cascade: " << cascadePath << std::endl;
+        return false;
+    }
+    path = cascadePath;
+    return true;
+}
+
+/// @brief Run detectMultiScale with the configured scale step and neighbour count
+std::vector<cv::Rect> CascadeBackend::detect(const cv::Mat& gray, const DetectionParams& params, cv::Size minSize,
+                                             cv::Size maxSize) {
+    std::vector<cv::Rect> faces;
+    cascade.detectMultiScale(gray, faces, params.scaleFactor, params.minNeighbors, 0|cv::CASCADE_SCALE_IMAGE,
+                             minSize, maxSize);
+    return faces;
+}
+
+/// @brief The cascade's training window, 24x24 for the frontal face cascades
+cv::Size CascadeBackend::windowSize() const {
+    return cascade.getOriginalWindowSize();
+}
+
+/// @brief "haar" or "lbp"
+std::string CascadeBackend::name() const {
+    return backendName;
+}
+
+/// @brief Load the same cascade file into a new classifier
+std::unique_ptr<DetectorBackend> CascadeBackend::clone() const {
+    auto copy = std::make_unique<CascadeBackend>(backendName);
+    if (!copy->load(path)) {
+        return nullptr;
+    }
+    return copy;
+}
+
+/// @brief Load the network
+/**
+ * @param model Path to the weights, e.g. res10_300x300_ssd_iter_140000.caffemodel.
+ * @param config Path to the network description, e.g. deploy.prototxt.
+ * @return true if the network was loaded, false otherwise.
+ */
+bool DnnBackend::load(const std::string& model, const std::string& config) {
+    try {
+        net = cv::dnn::readNet(model, config);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error loading DNN face detector " << model << ": " << e.what() << std::endl;
+        return false;
+    }
+    if (net.empty()) {
+        std::cerr << "Error loading DNN face detector: " << model << std::endl;
+        return false;
+    }
+    modelPath = model;
+    configPath = config;
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    return true;
+}
+
+/// @brief Run the network once and keep the boxes above the confidence threshold within the size range
+/**
+ * The network expects a color image, so the grayscale input is replicated into three channels. Its output is a
+ * 1x1xNx7 blob of [image, class, score, left, top, right, bottom] rows with coordinates relative to the input.
+ */
+std::vector<cv::Rect> DnnBackend::detect(const cv::Mat& gray, const DetectionParams& params, cv::Size minSize,
+                                         cv::Size maxSize) {
+    std::vector<cv::Rect> faces;
+    cv::cvtColor(gray, bgr, cv::COLOR_GRAY2BGR);
+    net.setInput(cv::dnn::blobFromImage(bgr, 1.0, kDnnInputSize, kDnnMean, false, false));
+    cv::Mat output = net.forward();
+    cv::Mat rows(output.size[2], output.size[3], CV_32F, output.ptr<float>());
+
+    cv::Rect bounds(0, 0, gray.cols, gray.rows);
+    for (int i = 0; i < rows.rows; i++) {
+        const float* row = rows.ptr<float>(i);
+        if (row[2] < params.confidence) {
+            continue;
+        }
+        cv::Rect face = cv::Rect(cv::Point(static_cast<int>(row[3] * gray.cols), static_cast<int>(row[4] * gray.rows)),
+                                 cv::Point(static_cast<int>(row[5] * gray.cols), static_cast<int>(row[6] * gray.rows)))
+                        & bounds;
+        if (face.width < minSize.width || face.height < minSize.height ||
+            (maxSize.width > 0 && face.width > maxSize.width) || (maxSize.height > 0 && face.height > maxSize.height)) {
+            continue;
+        }
+        faces.push_back(face);
+    }
+    return faces;
+}
+
+/// @brief The network input, so FaceDetector does not shrink the frame before the network resizes it anyway
+cv::Size DnnBackend::windowSize() const {
+    return kDnnInputSize;
+}
+
+/// @brief "dnn"
+std::string DnnBackend::name() const {
+    return "dnn";
+}
+
+/// @brief Load the same network files into a new net
+std::unique_ptr<DetectorBackend> DnnBackend::clone() const {
+    auto copy = std::make_unique<DnnBackend>();
+    if (!copy->load(modelPath, configPath)) {
+        return nullptr;
+    }
+    return copy;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/dnn.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/// @brief Tuning of the detection scan
+struct DetectionParams {
+    double scaleFactor = 1.3;                ///< Step between pyramid scales (cascades)
+    int minNeighbors = 5;                    ///< Overlapping hits required to keep a detection (cascades)
+    cv::Size minSize = cv::Size(60, 60);     ///< Smallest face searched for
+    cv::Size maxSize = cv::Size(350, 350);   ///< Largest face searched for
+    double regionPadding = 0.5;              ///< Margin added on each side of a previous box, as a fraction of its size
+    double scaleBand = 1.4;                  ///< Region scans search sizes within this factor of the previous box
+    int decimation = 0;                      ///< Scan a copy shrunk by 1, 2 or 4; 0 picks it from minSize
+    float confidence = 0.5f;                 ///< Minimum score of a face (DNN)
+    int threads = 1;                         ///< Workers for tile-parallel full-frame scans; 1 scans serially
+};
+
+
+/// @brief One way of finding faces in a grayscale image.
+/**
+ * FaceDetector takes care of decimation, region scans and coordinate mapping; a backend only has to find faces of
+ * a given size range in the image it is handed. Backends are chosen at runtime from detector.yml, so a site can
+ * trade recall for speed without a rebuild.
+ *
+ * @file DetectorBackend.h
+ */
+class DetectorBackend {
+public:
+    virtual ~DetectorBackend() = default;
+
+    /// @brief Find faces in an image
+    /**
+     * @param gray Grayscale image, possibly a decimated crop of the frame.
+     * @param params Scan parameters.
+     * @param minSize Smallest face to report, in the image's pixels.
+     * @param maxSize Largest face to report, in the image's pixels.
+     * @return Face boxes in the image's coordinates.
+     */
+    virtual std::vector<cv::Rect> detect(const cv::Mat& gray, const DetectionParams& params, cv::Size minSize,
+                                         cv::Size maxSize) = 0;
+
+    /// @brief Smallest face the backend can find without upscaling; images are never decimated below it
+    virtual cv::Size windowSize() const = 0;
+
+    /// @brief Backend name as written in detector.yml
+    virtual std::string name() const = 0;
+
+    /// @brief Load an independent copy of the backend for use on another thread
+    /**
+     * Neither cv::CascadeClassifier nor cv::dnn::Net may run on two threads at once, so parallel scans give every
+     * worker its own copy.
+     *
+     * @return The copy, or nullptr if the model could not be loaded again.
+     */
+    virtual std::unique_ptr<DetectorBackend> clone() const = 0;
+};
+
+
+/// @brief Viola-Jones cascade, either Haar or LBP features, run through cv::CascadeClassifier
+/**
+ * The LBP frontal face cascade evaluates integer features only and is several times faster than the Haar one,
+ * at the cost of some recall on poorly lit or turned faces.
+ */
+class CascadeBackend : public DetectorBackend {
+public:
+    /// @brief Constructor records which kind of cascade this is
+    /**
+     * @param name "haar" or "lbp", reported by name().
+     */
+    explicit CascadeBackend(std::string name);
+
+    /// @brief Load the cascade XML file
+    /**
+     * @param cascadePath Path to the cascade XML file.
+     * @return true if the cascade was loaded successfully, false otherwise.
+     */
+    bool load(const std::string& cascadePath);
+
+    std::vector<cv::Rect> detect(const cv::Mat& gray, const DetectionParams& params, cv::Size minSize,
+                                 cv::Size maxSize) override;
+    cv::Size windowSize() const override;
+    std::string name() const override;
+    std::unique_ptr<DetectorBackend> clone() const override;
+
+private:
+    std::string backendName;
+    std::string path;
+    cv::CascadeClassifier cascade;
+};
+
+
+/// @brief Single-shot CNN face detector run on the CPU through cv::dnn
+/**
+ * Intended for OpenCV's res10 300x300 SSD face model (Caffe), which finds turned and partially lit faces the
+ * cascades miss. Every call resizes its input to the network's 300x300 input, so the cost is roughly constant
+ * regardless of the image size.
+ */
+class DnnBackend : public DetectorBackend {
+public:
+    /// @brief Load the network
+    /**
+     * @param model Path to the weights, e.g. res10_300x300_ssd_iter_140000.caffemodel.
+     * @param config Path to the network description, e.g. deploy.prototxt.
+     * @return true if the network was loaded, false otherwise.
+     */
+    bool load(const std::string& model, const std::string& config);
+
+    std::vector<cv::Rect> detect(const cv::Mat& gray, const DetectionParams& params, cv::Size minSize,
+                                 cv::Size maxSize) override;
+    cv::Size windowSize() const override;
+    std::string name() const override;
+    std::unique_ptr<DetectorBackend> clone() const override;
+
+private:
+    std::string modelPath;
+    std::string configPath;
+    cv::dnn::Net net;
+    cv::Mat bgr;
+};
@@ -1,11 +1,11 @@
 #include "EditProfile.h"
 #include <QFile>
-#include <QTextStream>
 #include <QLabel>
 #include <QFrame>
 #include <QDebug>
 #include <QPushButton>
-#include <QScrollArea>
+#include <QLineEdit>
+#include <QListView>
 #include <QDir>
 #include <QPixmap>
 #include <QSplitter>
@@ -14,6 +14,8 @@
 #include <QCloseEvent>
 #include <QCoreApplication>
 #include <QDateTime>
+#include <QFileDialog>
+#include <QTimer>
 
 /**
 * @brief This class provides functionality to edit a user's job status and access levels.
@@ -27,11 +29,16 @@
  * This constructor initializes the GUI layout, including the sidebar, middle section, and right section.
  * It also displays the profile details (name, date joined, highest access level, and job status) in the GUI.
  * The GUI includes buttons on the sidebar for navigating back and refreshing the dataset.
- * The middle section displays the profile details, and the right section contains a scroll area for profile buttons.
+ * The middle section displays the profile details, and the sidebar lists the names with a search box above them.
+ * The profiles come from the ProfileStore shared with the main window, reloaded if names.csv changed on disk.
+ * While the panel is open the store is checked once a second, so profiles added or changed meanwhile, e.g. through
+ * the face manager or by another program, show up in the list without reopening it.
  *
  * @author Kevin Russel
  */
 EditProfile::EditProfile(QWidget *parent) : QWidget(parent) {
+    profiles = ProfileStore::open(std::string(PROJECT_ROOT_DIR) + "/textfiles/names.csv",
+                                  std::string(PROJECT_ROOT_DIR) + "/recognizer/labels.txt");
     setFixedSize(800, 600);
     // Set global dark mode for the entire widget
     setStyleSheet("background-color: #121212; color: #ffffff;");
@@ -114,57 +121,75 @@ EditProfile::EditProfile(QWidget *parent) : QWidget(parent) {
     rightLayout->addWidget(refreshButton, 0, Qt::AlignRight);
     connect(refreshButton, &QPushButton::clicked, this, &EditProfile::refreshCSV);
 
+    // Add the "Import CSV" and "Export CSV" buttons to exchange the profiles with other tools
+    auto *importButton = new QPushButton("Import CSV", this);
+    importButton->setStyleSheet("background-color: #3a3a3a; color: white; padding: 5px;");
+    rightLayout->addWidget(importButton, 0, Qt::AlignRight);
+    connect(importButton, &QPushButton::clicked, this, &EditProfile::importCSV);
+
+    auto *exportButton = new QPushButton("Export CSV", this);
+    exportButton->setStyleSheet("background-color: #3a3a3a; color: white; padding: 5px;");
+    rightLayout->addWidget(exportButton, 0, Qt::AlignRight);
+    connect(exportButton, &QPushButton::clicked, this, &EditProfile::exportCSV);
+
     // Combine sections into main layout
     mainLayout->addWidget(sidebar);
     mainLayout->addWidget(middleSection, 1);
     mainLayout->addWidget(rightSection);
 
     setLayout(mainLayout);
+
+    // One stat per file and second; the list is only rebuilt when something changed
+    auto *refreshTimer = new QTimer(this);
+    connect(refreshTimer, &QTimer::timeout, this, [this]() {
+        if (profiles->refresh()) {
+            profileModel->reload();
+        }
+    });
+    refreshTimer->start(1000);
 }
 
 /// @brief creates the top scetion of the sidebar
 /**
  * @return A pointer to the top section of the sidebar
  *
- * This function creates a scrollable area containing buttons for each name in the CSV file.
- * Each button, when clicked, loads the corresponding profile information.
+ * This function creates a search box above a list of every name in the CSV file. The list is a QListView on a
+ * ProfileListModel, so only the rows on screen are created, however many employees there are. Typing in the search
+ * box narrows the list to the names containing the text. Clicking a name loads the corresponding profile information.
  * The top section is styled with a dark background and contains a label prompting the user to select a name.
  */
 QFrame* EditProfile::CreateTopSection() {
-    QString textfilePath = QString(PROJECT_ROOT_DIR) + "/textfiles";
-
     auto *topSection = new QFrame();
     topSection->setFrameShape(QFrame::Box);
     // Dark background for top section
     topSection->setStyleSheet("background-color: #2c2c2c;");
 
-    // Scroll area for profile buttons
-    auto *scrollArea = new QScrollArea();
-    scrollArea->setWidgetResizable(true);
-    scrollArea->setStyleSheet("background-color: #2c2c2c;");
-
-    auto *scrollContainer = new QWidget();
-    auto *scrollLayout = new QVBoxLayout(scrollContainer);
-    int numLines = countLinesInFile();
-
-    // Create a button for each name in the file
-    for (int i = 0; i < numLines; i++) {
-        QString name = getName(i);
-        auto *profile = new QPushButton(name + " " + QString::number(i));
-        profile->setStyleSheet("background-color: #3a3a3a; border: 1px solid #555555; padding: 5px; color: white;");
-        connect(profile, &QPushButton::clicked, this, [this, name]() {
-            loadFirstLine(name);
-        });
-        scrollLayout->addWidget(profile);
-    }
-    scrollContainer->setLayout(scrollLayout);
-    scrollArea->setWidget(scrollContainer);
+    auto *searchBox = new QLineEdit();
+    searchBox->setPlaceholderText("Search");
+    searchBox->setClearButtonEnabled(true);
+    searchBox->setStyleSheet("background-color: #3a3a3a; border: 1px solid #555555; padding: 5px; color: white;");
+
+    // One model and one view for all names; the rows share a single style sheet
+    profileModel = new ProfileListModel(profiles, this);
+    auto *profileList = new QListView();
+    profileList->setModel(profileModel);
+    profileList->setUniformItemSizes(true);
+    profileList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    profileList->setStyleSheet("QListView { background-color: #2c2c2c; color: white; }"
+                               "QListView::item { background-color: #3a3a3a; border: 1px solid #555555;"
+                               " padding: 5px; margin: 2px 0px; }"
+                               "QListView::item:selected { background-color: #555555; }");
+    connect(searchBox, &QLineEdit::textChanged, profileModel, &ProfileListModel::setFilter);
+    connect(profileList, &QListView::clicked, this, [this](const QModelIndex &index) {
+        loadFirstLine(index.data().toString());
+    });
 
     auto *topLayout = new QVBoxLayout(topSection);
     auto *prompting = new QLabel("<h2>Names</h2>");
     prompting->setStyleSheet("color: white;");
     topLayout->addWidget(prompting);
-    topLayout->addWidget(scrollArea);
+    topLayout->addWidget(searchBox);
+    topLayout->addWidget(profileList);
     topSection->setLayout(topLayout);
 
     return topSection;
@@ -202,121 +227,54 @@ QFrame* EditProfile::createMiddleSection() {
     return middleSection;
 }
 
-/// @brief Loads the first line of the CSV file and updates the profile information
+/// @brief Loads the profile of a user and updates the profile information
 /**
  * @param name The name of the user whose profile information is to be loaded
  *
- * This function opens the "names.csv" file and reads the first line. It updates the profile information
+ * This function looks the name up in the profile store. It updates the profile information
  * (name, date joined, job status, access level) based on the data in the CSV file. If no matching images are found,
  * it falls back to a default sample icon.
  */
 void EditProfile::loadFirstLine(QString name) {
-    QString textfilePath = QString(PROJECT_ROOT_DIR) + "/textfiles";
-    QFile file(textfilePath + "/names.csv");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qDebug() << "Error opening file loadfirst:" << file.errorString();
+    Profile profile;
+    if (!profiles->find(name.toStdString(), profile)) {
+        qDebug() << "No profile found for:" << name;
         return;
     }
-    QTextStream in(&file);
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        QStringList parts = line.split(",");
-        qDebug() << parts;
-        if (parts[0] == name) {
-            // Find the first image in the matching-name folder
-            QString datasetFolder = QString(PROJECT_ROOT_DIR) + "/dataset/" + name;
-            QDir dir(datasetFolder);
-            QStringList filters;
-            filters << "*.png" << "*.jpg" << "*.jpeg" << "*.bmp";
-            dir.setNameFilters(filters);
-            QStringList imageFiles = dir.entryList(QDir::Files, QDir::Name);
-            if (!imageFiles.isEmpty()) {
-                // Use the first image in the folder
-                QString imagePath = datasetFolder + "/" + imageFiles.first();
-                if (QFile::exists(imagePath)) {
-                    imageLabel->setPixmap(QPixmap(imagePath).scaled(400, 400, Qt::KeepAspectRatio));
-                } else {
-                    imageLabel->setPixmap(QPixmap(QString(PROJECT_ROOT_DIR) + "/dataset/Sample_User_Icon.png")
-                                           .scaled(400, 400, Qt::KeepAspectRatio));
-                }
-            } else {
-                // If no matching images are found, fall back to the default sample icon
-                imageLabel->setPixmap(QPixmap(QString(PROJECT_ROOT_DIR) + "/dataset/Sample_User_Icon.png")
-                                       .scaled(400, 400, Qt::KeepAspectRatio));
-            }
-            // Update profile information
-            nameLabel->setText("Name: " + parts[0]);
-            dateLabel->setText("Date Joined: " + parts[1]);
-            jobLabel->setText("Job Status: " + parts[2]);
-            accessLabel->setText("Access Level: " + parts[3]);
-            break;
+    // Find the first image in the matching-name folder
+    QString datasetFolder = QString(PROJECT_ROOT_DIR) + "/dataset/" + name;
+    QDir dir(datasetFolder);
+    QStringList filters;
+    filters << "*.png" << "*.jpg" << "*.jpeg" << "*.bmp";
+    dir.setNameFilters(filters);
+    QStringList imageFiles = dir.entryList(QDir::Files, QDir::Name);
+    if (!imageFiles.isEmpty()) {
+        // Use the first image in the folder
+        QString imagePath = datasetFolder + "/" + imageFiles.first();
+        if (QFile::exists(imagePath)) {
+            imageLabel->setPixmap(QPixmap(imagePath).scaled(400, 400, Qt::KeepAspectRatio));
+        } else {
+            imageLabel->setPixmap(QPixmap(QString(PROJECT_ROOT_DIR) + "/dataset/Sample_User_Icon.png")
+                                   .scaled(400, 400, Qt::KeepAspectRatio));
         }
+    } else {
+        // If no matching images are found, fall back to the default sample icon
+        imageLabel->setPixmap(QPixmap(QString(PROJECT_ROOT_DIR) + "/dataset/Sample_User_Icon.png")
+                               .scaled(400, 400, Qt::KeepAspectRatio));
     }
-    file.close();
-}
-/// @brief Gets the name of the user from the CSV file based on the line number
-/**
- * @param number The line number in the CSV file
- * @return The name of the user at the specified line number
- *
- * This function opens the "names.csv" file and reads the specified line. It returns the name of the user
- * at that line number. If the file cannot be opened or if the line number is invalid, it returns "None".
- */
-QString EditProfile::getName(int number) {
-    QString textfilePath = QString(PROJECT_ROOT_DIR) + "/textfiles";
-    QFile file(textfilePath + "/names.csv");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qDebug() << "Error opening file getname:" << file.errorString();
-        return "None";
-    }
-    QTextStream in(&file);
-    if (number == 0) {
-        QString line = in.readLine();
-        QStringList parts = line.split(",");
-        file.close();
-        return parts[0];
-    }
-    int linecount = 0;
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        QStringList parts = line.split(",");
-        if (!line.isEmpty() && linecount == number) {
-            file.close();
-            return parts[0];
-        }
-        linecount++;
-    }
-    file.close();
-    return "Unassigned";
+    // Update profile information
+    nameLabel->setText("Name: " + name);
+    dateLabel->setText("Date Joined: " + QString::fromStdString(profile.dateJoined));
+    jobLabel->setText("Job Status: " + QString::fromStdString(profile.permission));
+    accessLabel->setText("Access Level: " + QString::fromStdString(profile.door));
 }
 
-/// @brief Counts the number of non-empty lines in the CSV file
+/// @brief Counts the number of profiles in the CSV file
 /**
- * @return The number of non-empty lines in the CSV file. If the CSV cannot be opened, it returns -1.
- *
- * This function first opens the "names.csv" file. If the file cannot open properly, it outputs an error message
- * and returns -1. Otherwise, it reads through the file line by line, counting the number of non-empty lines.
- * The function then returns the count of non-empty lines.
+ * @return The number of non-empty lines in the CSV file, as held by the profile store.
  */
-/// @return
 int EditProfile::countLinesInFile() {
-    QString textfilePath = QString(PROJECT_ROOT_DIR) + "/textfiles";
-    QFile file(textfilePath + "/names.csv");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qDebug() << "Error opening file countlines:" << file.errorString();
-        return -1;
-    }
-    QTextStream in(&file);
-    int linecount = 0;
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        if (!line.isEmpty()) {
-            linecount++;
-        }
-    }
-    qDebug() << "Here is the number of lines" << linecount;
-    file.close();
-    return linecount;
+    return static_cast<int>(profiles->size());
 }
 
 /// @brief Displays a popup showing the the current access level of the user and allows the user to edit it
@@ -395,56 +353,28 @@ void EditProfile::editAccessLevel() {
 
 /// @brief Edits the CSV file with the new job status and access level for a given name
 /**
+ * @param name The name label of the user, "Name: " followed by the name
  * @param job The new job status to be set for the user
  * @param access The new access level to be set for the user
  *
- * This function takes the new job status and access level as parameters and updates the CSV file
- * accordingly. It searches for the user's name in the CSV file and modifies the corresponding line
- * with the new values. If the user is not found, it outputs an error message.
- * The function also handles file opening and closing, ensuring that the changes are saved correctly.
+ * This function takes the new job status and access level as parameters and updates the user's profile in the
+ * profile store, which appends the change to its log instead of rewriting the CSV file. If the user is not found, it
+ * outputs an error message.
  */
 void EditProfile::editCSVFile(const QString& name, const QString& job, const QString& access) {
-    QString textfilePath = QString(PROJECT_ROOT_DIR) + "/textfiles";
-    QFile file(textfilePath + "/names.csv");
     QStringList Splitting = name.split(": ");
-    const QString& newName = Splitting[1];
-    qDebug() << "Here is the name" << newName;
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qDebug() << "Error opening file for reading:" << file.errorString();
-        return;
-    }
-    QTextStream in(&file);
-    QStringList lines;
-    bool modified = false;
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        QStringList parts = line.split(",");
-        if (!parts.isEmpty() && parts[0].trimmed() == newName) {
-            if (parts.size() > 3) {
-                parts[2] = job;
-                parts[3] = access;
-                line = parts.join(",");
-                modified = true;
-            }
-        }
-        lines.append(line);
-    }
-    file.close();
-    if (!modified) {
+    const QString& newName = Splitting.size() > 1 ? Splitting[1] : name;
+    Profile profile;
+    if (!profiles->find(newName.trimmed().toStdString(), profile)) {
         qDebug() << "No matching entry found for:" << newName;
         return;
     }
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-        qDebug() << "Error opening file for writing:" << file.errorString();
+    profile.permission = job.toStdString();
+    profile.door = access.toStdString();
+    if (!profiles->update(profile)) {
+        qDebug() << "Error writing profile of" << newName;
         return;
     }
-    QTextStream out(&file);
-    qDebug() << "Writing back modified lines.";
-    for (const QString &line : lines) {
-        qDebug() << "Writing:" << line;
-        out << line << "\n";
-    }
-    file.close();
     qDebug() << "File updated successfully!";
 }
 
@@ -457,7 +387,8 @@ void EditProfile::onBackButtonClicked() {
 
 /// @brief Refreshes the CSV file
 /**
-* Refreshes the CSV file by scanning the dataset directory and updating the file with folder names and metadata.
+* Refreshes the CSV file by scanning the dataset directory and replacing all profiles with the folder names and
+* metadata, written as a new snapshot by the profile store.
 */
 void EditProfile::refreshCSV() {
     // Build the dataset folder path
@@ -471,33 +402,69 @@ void EditProfile::refreshCSV() {
     datasetDir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
     QFileInfoList folderList = datasetDir.entryInfoList();
 
-    // Open the names.csv file for writing (overwrite)
-    QString csvPath = QString(PROJECT_ROOT_DIR) + "/textfiles/names.csv";
-    QFile csvFile(csvPath);
-    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-         qDebug() << "Error opening CSV file for writing:" << csvFile.errorString();
-         return;
-    }
-    QTextStream out(&csvFile);
-    // For each folder, write: folderName, lastModified, "Employee", 1
+    // For each folder: folderName, lastModified, "Employee", 1
+    std::vector<Profile> rows;
     for (const QFileInfo &folderInfo : folderList) {
-         QString folderName = folderInfo.fileName();
-         QDateTime lastModified = folderInfo.lastModified();
-         QString dateStr = lastModified.toString("yyyy-MM-dd HH:mm:ss");
-         out << folderName << "," << dateStr << "," << "Employee" << "," << 1 << "\n";
+         Profile profile;
+         profile.name = folderInfo.fileName().toStdString();
+         profile.dateJoined = folderInfo.lastModified().toString("yyyy-MM-dd HH:mm:ss").toStdString();
+         profile.permission = "Employee";
+         profile.door = "1";
+         rows.push_back(profile);
+    }
+    // The profile store writes the new names.csv through a temporary file and a rename
+    if (!profiles->replaceAll(rows)) {
+         qDebug() << "Error writing CSV file";
+         return;
     }
-    csvFile.close();
+    profileModel->reload();
     qDebug() << "CSV refreshed successfully!";
 }
 
+/// @brief Replaces all profiles with the rows of a CSV file chosen by the user
+/**
+ * The file has the name,dateJoined,permission,door lines of names.csv. Its rows become the new names.csv snapshot,
+ * written by the profile store through a temporary file and a rename, and the list of names is reloaded.
+ */
+void EditProfile::importCSV() {
+    QString path = QFileDialog::getOpenFileName(this, "Import CSV", QString(), "CSV files (*.csv);;All files (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+    if (!profiles->importCsv(path.toStdString())) {
+        qDebug() << "Error importing CSV file" << path;
+        return;
+    }
+    profileModel->reload();
+    qDebug() << "CSV imported successfully!";
+}
+
+/// @brief Writes all profiles to a CSV file chosen by the user
+/**
+ * The file gets the current profiles, including the edits not yet folded into names.csv, in the names.csv format.
+ */
+void EditProfile::exportCSV() {
+    QString path = QFileDialog::getSaveFileName(this, "Export CSV", "names.csv", "CSV files (*.csv);;All files (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+    if (!profiles->exportCsv(path.toStdString())) {
+        qDebug() << "Error exporting CSV file" << path;
+        return;
+    }
+    qDebug() << "CSV exported successfully!";
+}
+
 /// @brief Handles the close event of the widget
 /**
  * @param event The close event
  *
- * This function handles the close event of the widget. If the close event is triggered by the back button,
+ * This function handles the close event of the widget. The edits made in the panel are folded into names.csv first,
+ * so other programs reading the CSV file see them. If the close event is triggered by the back button,
  * it allows the event to be accepted. Otherwise, it quits the application.
  */
 void EditProfile::closeEvent(QCloseEvent *event) {
+    profiles->compact();
     if (!m_fromBackButton) {
         QCoreApplication::quit();
     } else {
@@ -4,7 +4,10 @@
 #include <QWidget>
 #include <QLabel>
 #include <QVBoxLayout>
-#include <QScrollArea>
+#include <memory>
+
+#include "ProfileListModel.h"
+#include "ProfileStore.h"
 
 /// @brief This class provides functionality to edit a user's job status and access levels.
 /**
@@ -23,19 +26,14 @@ class EditProfile: public QWidget{
      * This constructor initializes the GUI layout, including the sidebar, middle section, and right section.
      * It also displays the profile details (name, date joined, highest access level, and job status) in the GUI.
      * The GUI includes buttons on the sidebar for navigating back and refreshing the dataset.
-     * The middle section displays the profile details, and the right section contains a scroll area for profile buttons.
+     * The middle section displays the profile details, and the sidebar lists the names with a search box above them.
      */
     explicit EditProfile(QWidget *parent = nullptr);
 
-    /// @brief Counts the number of non-empty lines in the CSV file
+    /// @brief Counts the number of profiles in the CSV file
     /**
-     * @return The number of non-empty lines in the CSV file. If the CSV cannot be opened, it returns -1.
-     *
-     * This function first opens the "names.csv" file. If the file cannot open properly, it outputs an error message
-     * and returns -1. Otherwise, it reads through the file line by line, counting the number of non-empty lines.
-     * The function then returns the count of non-empty lines.
+     * @return The number of non-empty lines in the CSV file, as held by the profile store.
      */
-    /// @return
     int countLinesInFile();
 
     /// @brief Displays a popup showing the the current access level of the user and allows the user to edit it
@@ -55,15 +53,15 @@ class EditProfile: public QWidget{
 
     /// @brief Edits the CSV file with the new job status and access level for a given name
     /**
+     * @param name The name label of the user, "Name: " followed by the name
      * @param job The new job status to be set for the user
      * @param access The new access level to be set for the user
      *
-     * This function takes the new job status and access level as parameters and updates the CSV file
-     * accordingly. It searches for the user's name in the CSV file and modifies the corresponding line
-     * with the new values. If the user is not found, it outputs an error message.
-     * The function also handles file opening and closing, ensuring that the changes are saved correctly.
+     * This function takes the new job status and access level as parameters and updates the user's profile in the
+     * profile store, which appends the change to its log instead of rewriting the CSV file. If the user is not found,
+     * it outputs an error message.
      */
-    static void editCSVFile(const QString&, const QString& job, const QString& access);
+    void editCSVFile(const QString& name, const QString& job, const QString& access);
 
     void closeEvent(QCloseEvent *event);
 
@@ -73,16 +71,23 @@ private slots:
 
     /// @brief Refreshes the CSV file
     /**
-     * Refreshes the CSV file by scanning the dataset directory and updating the file with folder names and metadata.
+     * Refreshes the CSV file by scanning the dataset directory and replacing all profiles with the folder names and
+     * metadata, written as a new snapshot by the profile store.
      */
     void refreshCSV();
 
+    /// @brief Replaces all profiles with the rows of a CSV file chosen by the user
+    void importCSV();
+
+    /// @brief Writes all profiles to a CSV file chosen by the user
+    void exportCSV();
+
 private:
     QFrame* createWindowFrame();
     QFrame* CreateTopSection();
     QFrame* createMiddleSection();
-    QScrollArea *scrollArea;
-    QString getName(int);
+    ProfileListModel *profileModel;           ///< Names shown in the sidebar, filtered by the search box
+    std::shared_ptr<ProfileStore> profiles;   ///< names.csv indexed in memory, shared with the main window
     QLabel *firstLineLabel;
     QLabel *imageLabel;
     QLabel* nameLabel;
@@ -1,11 +1,99 @@
 #include "FaceDetector.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
+#include <numeric>
 
 /**
  * @brief detection class incorporting OpenCV's Haar Cascade Classifier
  * @file FaceDetector.cpp
  */
 
+namespace {
+
+/// One piece of a parallel scan: an area of the image and the face sizes searched for in it
+struct ScanUnit {
+    cv::Rect tile;
+    cv::Size minSize;
+    cv::Size maxSize;
+    double cost = 0.0;   ///< Estimated work, proportional to the number of windows at the finest scale
+};
+
+/**
+ * @brief Split a scan into scale bands and overlapping tiles
+ *
+ * The size range is divided geometrically into up to one band per worker. Each band is then cut into tiles that
+ * overlap by the band's largest face size, so every face the band can find lies entirely inside at least one tile.
+ * Small-face bands, which do most of the work, get the most tiles.
+ */
+std::vector<ScanUnit> planScan(cv::Size image, cv::Size minSize, cv::Size maxSize, double scaleFactor, int workers) {
+    std::vector<ScanUnit> units;
+    int minSide = std::max(1, std::min(minSize.width, minSize.height));
+    int maxSide = std::min(image.width, image.height);
+    if (maxSize.width > 0 && maxSize.height > 0) {
+        maxSide = std::min(maxSide, std::max(maxSize.width, maxSize.height));
+    }
+    if (maxSide < minSide) {
+        return units;
+    }
+
+    double ratio = static_cast<double>(maxSide) / minSide;
+    int levels = 1 + static_cast<int>(std::log(ratio) / std::log(std::max(scaleFactor, 1.01)));
+    int bands = std::max(1, std::min(workers, levels));
+    for (int band = 0; band < bands; band++) {
+        int lo = static_cast<int>(std::lround(minSide * std::pow(ratio, static_cast<double>(band) / bands)));
+        int hi = band + 1 == bands ? maxSide
+                                   : static_cast<int>(std::lround(minSide * std::pow(ratio, static_cast<double>(band + 1) / bands)));
+
+        int tilesX = std::max(1, std::min(workers, image.width / (2 * hi)));
+        int tilesY = std::max(1, std::min(workers, image.height / (2 * hi)));
+        while (tilesX * tilesY > workers) {
+            (tilesX >= tilesY ? tilesX : tilesY)--;
+        }
+        int stepX = (image.width + tilesX - 1) / tilesX;
+        int stepY = (image.height + tilesY - 1) / tilesY;
+        for (int ty = 0; ty < tilesY; ty++) {
+            for (int tx = 0; tx < tilesX; tx++) {
+                ScanUnit unit;
+                unit.tile = cv::Rect(tx * stepX, ty * stepY, stepX + hi, stepY + hi) & cv::Rect(cv::Point(0, 0), image);
+                unit.minSize = cv::Size(lo, lo);
+                unit.maxSize = cv::Size(hi, hi);
+                unit.cost = static_cast<double>(unit.tile.area()) / (static_cast<double>(lo) * lo);
+                if (unit.tile.width >= lo && unit.tile.height >= lo) {
+                    units.push_back(unit);
+                }
+            }
+        }
+    }
+    return units;
+}
+
+/**
+ * @brief Merge the boxes of several scan units, dropping duplicates
+ *
+ * A face can be reported by two tiles that overlap it, or by two neighbouring scale bands at slightly different
+ * sizes. Boxes are visited largest first and a box is dropped if it overlaps a kept one by more than 40%, or lies
+ * mostly inside it.
+ */
+std::vector<cv::Rect> suppressDuplicates(std::vector<cv::Rect> boxes) {
+    std::sort(boxes.begin(), boxes.end(), [](const cv::Rect& a, const cv::Rect& b) { return a.area() > b.area(); });
+    std::vector<cv::Rect> kept;
+    for (const auto& box : boxes) {
+        bool duplicate = std::any_of(kept.begin(), kept.end(), [&box](const cv::Rect& other) {
+            double intersection = (box & other).area();
+            double unionArea = box.area() + other.area() - intersection;
+            return intersection > 0.4 * unionArea || intersection > 0.8 * box.area();
+        });
+        if (!duplicate) {
+            kept.push_back(box);
+        }
+    }
+    return kept;
+}
+
+}
+
 /// @brief Constructor that optionally loads a cascade path
 /**
  * @param cascadePath Path to the Haar Cascade XML file. If empty, the cascade will be loaded later.
@@ -28,12 +116,109 @@ FaceDetector::FaceDetector(const std::string& cascadePath) {
  * If the file is not found or an error occurs during loading, the method returns false.
  */
 bool FaceDetector::loadCascade(const std::string& cascadePath) {
-    if (!faceCascade.load(cascadePath)) {
-        std::cerr << "Error loading cascade: " << cascadePath << std::endl;
+    auto cascade = std::make_unique<CascadeBackend>("haar");
+    if (!cascade->load(cascadePath)) {
         return false;
     }
+    backend = std::move(cascade);
+    workerBackends.clear();
     return true;
 }
+
+/// @brief Select the backend and scan parameters from a configuration file
+/**
+ * @param configPath Path to detector.yml.
+ * @param rootDir Directory that relative model paths in the file are resolved against.
+ * @return true if a backend was loaded, false if not even the Haar fallback could be.
+ *
+ * A missing file is not an error: the defaults (Haar cascade, the original scan parameters) are used.
+ */
+bool FaceDetector::loadConfig(const std::string& configPath, const std::string& rootDir) {
+    std::string backendChoice = "haar";
+    std::string haarPath = "cascades/haarcascade_frontalface_default.xml";
+    std::string lbpPath = "cascades/lbpcascade_frontalface_improved.xml";
+    std::string dnnModel = "models/res10_300x300_ssd_iter_140000.caffemodel";
+    std::string dnnConfig = "models/deploy.prototxt";
+    DetectionParams loaded = detectionParams;
+
+    cv::FileStorage config;
+    try {
+        config.open(configPath, cv::FileStorage::READ);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error reading detector config " << configPath << ": " << e.what() << std::endl;
+    }
+    if (config.isOpened()) {
+        auto read = [&config](const char* key, auto& value) {
+            cv::FileNode node = config[key];
+            if (!node.empty()) {
+                node >> value;
+            }
+        };
+        read("backend", backendChoice);
+        read("haarCascade", haarPath);
+        read("lbpCascade", lbpPath);
+        read("dnnModel", dnnModel);
+        read("dnnConfig", dnnConfig);
+        read("scaleFactor", loaded.scaleFactor);
+        read("minNeighbors", loaded.minNeighbors);
+        read("decimation", loaded.decimation);
+        read("threads", loaded.threads);
+        double confidence = loaded.confidence;
+        read("dnnConfidence", confidence);
+        loaded.confidence = static_cast<float>(confidence);
+        int minSide = loaded.minSize.width;
+        int maxSide = loaded.maxSize.width;
+        read("minSize", minSide);
+        read("maxSize", maxSide);
+        loaded.minSize = cv::Size(minSide, minSide);
+        loaded.maxSize = cv::Size(maxSide, maxSide);
+        if (loaded.decimation != 0 && loaded.decimation != 1 && loaded.decimation != 2 && loaded.decimation != 4) {
+            std::cerr << "Warning: decimation must be 0, 1, 2 or 4 in " << configPath << ", deriving it instead"
+                      << std::endl;
+            loaded.decimation = 0;
+        }
+    } else {
+        std::cerr << "Warning: No detector config at " << configPath << ", using the Haar cascade" << std::endl;
+    }
+    detectionParams = loaded;
+
+    auto resolve = [&rootDir](const std::string& path) {
+        std::filesystem::path resolved(path);
+        return resolved.is_absolute() ? path : (std::filesystem::path(rootDir) / resolved).string();
+    };
+
+    workerBackends.clear();
+    if (backendChoice == "lbp") {
+        auto cascade = std::make_unique<CascadeBackend>("lbp");
+        if (cascade->load(resolve(lbpPath))) {
+            backend = std::move(cascade);
+            return true;
+        }
+    } else if (backendChoice == "dnn") {
+        std::error_code error;
+        if (std::filesystem::exists(resolve(dnnModel), error)) {
+            auto network = std::make_unique<DnnBackend>();
+            if (network->load(resolve(dnnModel), resolve(dnnConfig))) {
+                backend = std::move(network);
+                return true;
+            }
+        } else {
+            std::cerr << "Warning: DNN face model " << resolve(dnnModel) << " not found" << std::endl;
+        }
+    } else if (backendChoice != "haar") {
+        std::cerr << "Warning: Unknown detector backend \"" << backendChoice << "\"" << std::endl;
+    }
+
+    if (backendChoice != "haar") {
+        std::cerr << "Warning: Falling back to the Haar cascade" << std::endl;
+    }
+    return loadCascade(resolve(haarPath));
+}
+
+/// @brief Name of the active backend, empty if none is loaded
+std::string FaceDetector::backendName() const {
+    return backend ? backend->name() : std::string();
+}
 /// @brief Detect faces in a given grayscale image
 /**
  * @param grayFrame Grayscale image in which to detect faces.
@@ -41,10 +226,184 @@ bool FaceDetector::loadCascade(const std::string& cascadePath) {
  *
  * This method takes a grayscale image as input and uses the loaded Haar Cascade classifier to detect faces.
  * It returns a vector of rectangles, each representing the bounding box of a detected face.
+ * The scan runs on a copy shrunk by decimation(); the boxes are mapped back to full-resolution coordinates,
+ * so callers can crop faces from the full-resolution image.
  */
 std::vector<cv::Rect> FaceDetector::detectFaces(const cv::Mat& grayFrame) {
+    // Adjust these parameters (scaleFactor, minNeighbors) through setParams() as needed
+    return scan(grayFrame, cv::Rect(0, 0, grayFrame.cols, grayFrame.rows), detectionParams.minSize, detectionParams.maxSize,
+                true);
+}
+
+/// @brief Detect faces only near where faces were seen before
+/**
+ * @param grayFrame Grayscale image in which to detect faces.
+ * @param previous Face boxes from an earlier frame, in full-frame coordinates.
+ * @return The faces found, in full-frame coordinates, with duplicates from overlapping regions removed.
+ *
+ * The size band is clamped to the global minimum and maximum face size and to the region itself. When two people
+ * stand close together their regions overlap and the same face can be found twice; a hit overlapping an earlier
+ * one by more than half is dropped.
+ */
+std::vector<cv::Rect> FaceDetector::detectAround(const cv::Mat& grayFrame, const std::vector<cv::Rect>& previous) {
     std::vector<cv::Rect> faces;
-    // Adjust these parameters (scaleFactor, minNeighbors) as needed
-    faceCascade.detectMultiScale(grayFrame, faces, 1.3, 5, 0|cv::CASCADE_SCALE_IMAGE, cv::Size(60, 60), cv::Size(350, 350) );
+    cv::Rect frameRect(0, 0, grayFrame.cols, grayFrame.rows);
+
+    for (const auto& box : previous) {
+        int padX = static_cast<int>(box.width * detectionParams.regionPadding);
+        int padY = static_cast<int>(box.height * detectionParams.regionPadding);
+        cv::Rect region = cv::Rect(box.x - padX, box.y - padY, box.width + 2 * padX, box.height + 2 * padY) & frameRect;
+
+        int side = std::max(box.width, box.height);
+        int minSide = std::max(detectionParams.minSize.width, static_cast<int>(side / detectionParams.scaleBand));
+        int maxSide = std::min({detectionParams.maxSize.width, static_cast<int>(std::ceil(side * detectionParams.scaleBand)),
+                                region.width, region.height});
+        if (region.empty() || minSide > maxSide) {
+            continue;
+        }
+
+        for (const auto& face : scan(grayFrame, region, cv::Size(minSide, minSide), cv::Size(maxSide, maxSide), false)) {
+            bool duplicate = std::any_of(faces.begin(), faces.end(), [&face](const cv::Rect& other) {
+                double intersection = (face & other).area();
+                return intersection > 0.5 * (face.area() + other.area() - intersection);
+            });
+            if (!duplicate) {
+                faces.push_back(face);
+            }
+        }
+    }
     return faces;
-}
\ No newline at end of file
+}
+
+/// @brief Replace the scan parameters
+void FaceDetector::setParams(const DetectionParams& newParams) {
+    detectionParams = newParams;
+}
+
+/// @brief The current scan parameters
+const DetectionParams& FaceDetector::params() const {
+    return detectionParams;
+}
+
+/// @brief Factor the frame is shrunk by before scanning
+/**
+ * @return DetectionParams::decimation if set, otherwise the largest of 4, 2 and 1 that keeps the smallest face
+ *         searched for at least as big as the cascade's detection window.
+ *
+ * With the default 60 px minimum and the 24 px window of the frontal face cascades this halves the frame, which
+ * quarters the number of pixels every pyramid level has to touch.
+ */
+int FaceDetector::decimation() const {
+    if (detectionParams.decimation > 0) {
+        return detectionParams.decimation;
+    }
+    cv::Size window = backend ? backend->windowSize() : cv::Size();
+    int windowSide = std::max({window.width, window.height, 24});
+    int minSide = std::min(detectionParams.minSize.width, detectionParams.minSize.height);
+    for (int factor : {4, 2}) {
+        if (minSide / factor >= windowSide) {
+            return factor;
+        }
+    }
+    return 1;
+}
+
+/// @brief Run the backend over one area of the frame
+/**
+ * @param grayFrame Full-resolution grayscale frame.
+ * @param area Part of the frame to scan.
+ * @param minSize Smallest face to report, in full-resolution pixels.
+ * @param maxSize Largest face to report, in full-resolution pixels.
+ * @param allowParallel Whether the scan may be split over worker threads.
+ * @return Detected faces in full-frame coordinates.
+ *
+ * The area is shrunk by decimation() before the scan and the size limits with it; detected boxes are scaled back
+ * up and offset by the area's origin.
+ */
+std::vector<cv::Rect> FaceDetector::scan(const cv::Mat& grayFrame, const cv::Rect& area, cv::Size minSize,
+                                         cv::Size maxSize, bool allowParallel) {
+    std::vector<cv::Rect> faces;
+    if (!backend) {
+        return faces;
+    }
+    cv::Mat image = grayFrame(area);
+    int factor = decimation();
+    if (factor > 1 && area.width >= factor && area.height >= factor) {
+        cv::resize(image, decimated, cv::Size(area.width / factor, area.height / factor), 0, 0, cv::INTER_AREA);
+        image = decimated;
+        minSize = cv::Size(minSize.width / factor, minSize.height / factor);
+        maxSize = cv::Size(maxSize.width / factor, maxSize.height / factor);
+    } else {
+        factor = 1;
+    }
+
+    if (allowParallel && detectionParams.threads > 1) {
+        faces = scanParallel(image, minSize, maxSize);
+    } else {
+        faces = backend->detect(image, detectionParams, minSize, maxSize);
+    }
+
+    for (auto& face : faces) {
+        face = cv::Rect(area.x + face.x * factor, area.y + face.y * factor, face.width * factor, face.height * factor);
+    }
+    return faces;
+}
+
+/// @brief Scan an image with several workers, each running its own copy of the backend
+/**
+ * @param image The (decimated) image to scan.
+ * @param minSize Smallest face to report, in the image's pixels.
+ * @param maxSize Largest face to report, in the image's pixels.
+ * @return Detected faces in the image's coordinates, duplicates from overlapping units removed.
+ *
+ * The scan is split by planScan() and the units are handed out longest first to the least loaded worker. Workers
+ * run on OpenCV's thread pool; worker 0 uses the main backend and the others use copies loaded on first use.
+ * Boxes near band and tile borders can differ slightly from a serial scan, because the cascade groups neighbouring
+ * hits within each unit only.
+ */
+std::vector<cv::Rect> FaceDetector::scanParallel(const cv::Mat& image, cv::Size minSize, cv::Size maxSize) {
+    int workers = detectionParams.threads;
+    while (static_cast<int>(workerBackends.size()) < workers - 1) {
+        std::unique_ptr<DetectorBackend> copy = backend->clone();
+        if (!copy) {
+            break;
+        }
+        workerBackends.push_back(std::move(copy));
+    }
+    workers = std::min(workers, static_cast<int>(workerBackends.size()) + 1);
+
+    std::vector<ScanUnit> units = planScan(image.size(), minSize, maxSize, detectionParams.scaleFactor, workers);
+    if (workers <= 1 || units.size() <= 1) {
+        return backend->detect(image, detectionParams, minSize, maxSize);
+    }
+
+    std::sort(units.begin(), units.end(), [](const ScanUnit& a, const ScanUnit& b) { return a.cost > b.cost; });
+    std::vector<std::vector<std::size_t>> assigned(workers);
+    std::vector<double> load(workers, 0.0);
+    for (std::size_t u = 0; u < units.size(); u++) {
+        int lightest = static_cast<int>(std::min_element(load.begin(), load.end()) - load.begin());
+        assigned[lightest].push_back(u);
+        load[lightest] += units[u].cost;
+    }
+
+    std::vector<std::vector<cv::Rect>> found(workers);
+    cv::parallel_for_(cv::Range(0, workers), [&](const cv::Range& range) {
+        for (int w = range.start; w < range.end; w++) {
+            DetectorBackend& worker = w == 0 ? *backend : *workerBackends[w - 1];
+            for (std::size_t u : assigned[w]) {
+                const ScanUnit& unit = units[u];
+                for (auto box : worker.detect(image(unit.tile), detectionParams, unit.minSize, unit.maxSize)) {
+                    box.x += unit.tile.x;
+                    box.y += unit.tile.y;
+                    found[w].push_back(box);
+                }
+            }
+        }
+    }, workers);
+
+    std::vector<cv::Rect> merged;
+    for (const auto& boxes : found) {
+        merged.insert(merged.end(), boxes.begin(), boxes.end());
+    }
+    return suppressDuplicates(merged);
+}
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "DetectorBackend.h"
 
 
 /// @brief detection class incorporting OpenCV's Haar Cascade Classifier
@@ -11,6 +13,8 @@
 * This class provides functionality to load a Haar Cascade XML file for face detection
 * and to detect faces in a given grayscale image. The class uses OpenCV's CascadeClassifier for the detection process.
 * If the cascade file is not provided at construction, it can be loaded later using the loadCascade method.
+* Alternatively loadConfig() reads detector.yml, which selects the backend (Haar, LBP cascade or a CPU DNN) and
+* the scan parameters, so each installation can pick its own speed/recall tradeoff.
 * @file FaceDetector.h
 * @author Naween Sawari
 */
@@ -35,6 +39,21 @@ public:
      */
     bool loadCascade(const std::string& cascadePath);
 
+    /// @brief Select the backend and scan parameters from a configuration file
+    /**
+     * @param configPath Path to detector.yml.
+     * @param rootDir Directory that relative model paths in the file are resolved against.
+     * @return true if a backend was loaded, false if not even the Haar fallback could be.
+     *
+     * The file names the backend ("haar", "lbp" or "dnn"), the model files of each and the scan parameters; any
+     * key that is missing keeps its default. If the selected backend's model is not present the Haar cascade is
+     * used instead, so a site without the DNN model still runs.
+     */
+    bool loadConfig(const std::string& configPath, const std::string& rootDir);
+
+    /// @brief Name of the active backend, empty if none is loaded
+    std::string backendName() const;
+
     /// @brief Detect faces in a given grayscale image
     /**
      * @param grayFrame Grayscale image in which to detect faces.
@@ -42,9 +61,44 @@ public:
      *
      * This method takes a grayscale image as input and uses the loaded Haar Cascade classifier to detect faces.
      * It returns a vector of rectangles, each representing the bounding box of a detected face.
+     * The scan runs on a copy shrunk by decimation(); the boxes are mapped back to full-resolution coordinates,
+     * so callers can crop faces from the full-resolution image. With DetectionParams::threads above 1 the scan is
+     * split into scale bands and overlapping tiles that run in parallel, see scanParallel().
      */
     std::vector<cv::Rect> detectFaces(const cv::Mat& grayFrame);
 
+    /// @brief Detect faces only near where faces were seen before
+    /**
+     * @param grayFrame Grayscale image in which to detect faces.
+     * @param previous Face boxes from an earlier frame, in full-frame coordinates.
+     * @return The faces found, in full-frame coordinates, with duplicates from overlapping regions removed.
+     *
+     * Each previous box is padded by DetectionParams::regionPadding and searched only for faces whose size is within
+     * DetectionParams::scaleBand of the previous one. With one or two people at a door this touches a small part of
+     * the frame at a handful of scales, instead of the whole frame at every scale.
+     */
+    std::vector<cv::Rect> detectAround(const cv::Mat& grayFrame, const std::vector<cv::Rect>& previous);
+
+    /// @brief Replace the scan parameters
+    void setParams(const DetectionParams& newParams);
+
+    /// @brief The current scan parameters
+    const DetectionParams& params() const;
+
+    /// @brief Factor the frame is shrunk by before scanning
+    /**
+     * @return DetectionParams::decimation if set, otherwise the largest of 4, 2 and 1 that keeps the smallest face
+     *         searched for at least as big as the backend's detection window.
+     */
+    int decimation() const;
+
 private:
-    cv::CascadeClassifier faceCascade;
+    std::vector<cv::Rect> scan(const cv::Mat& grayFrame, const cv::Rect& area, cv::Size minSize, cv::Size maxSize,
+                               bool allowParallel);
+    std::vector<cv::Rect> scanParallel(const cv::Mat& image, cv::Size minSize, cv::Size maxSize);
+
+    std::unique_ptr<DetectorBackend> backend;
+    std::vector<std::unique_ptr<DetectorBackend>> workerBackends;   ///< Copies of backend for parallel workers
+    cv::Mat decimated;
+    DetectionParams detectionParams;
 };
\ No newline at end of file
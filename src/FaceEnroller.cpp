@@ -0,0 +1,198 @@
+#include "FaceEnroller.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+/**
+ * @brief Applies changes to one person's images to the trained gallery without retraining the whole dataset.
+ * @file FaceEnroller.cpp
+ */
+
+namespace fs = std::filesystem;
+
+/// @brief Set up the enroller for a project directory
+/**
+ * @param rootDir Project root holding textfiles/detector.yml, textfiles/preprocess.yml and the recognizer
+ *                directory.
+ *
+ * Nothing is read until the first change, so constructing an enroller is cheap.
+ */
+FaceEnroller::FaceEnroller(const std::string& rootDir)
+    : root(rootDir),
+      galleryPath(rootDir + "/recognizer/gallery.bin"),
+      labelsPath(rootDir + "/recognizer/labels.txt") {
+}
+
+/// @brief Enroll new images of a person, creating the person if they are not enrolled yet
+/**
+ * @param personName Name of the person, the name of their dataset folder.
+ * @param imagePaths Images to enroll.
+ * @return The number of faces enrolled, or -1 if the gallery could not be loaded or saved.
+ *
+ * Only the given images are read and histogrammed; images without a detectable face are skipped with a warning, as
+ * in training.
+ */
+int FaceEnroller::addImages(const std::string& personName, const std::vector<std::string>& imagePaths) {
+    if (!load()) {
+        return -1;
+    }
+    std::vector<cv::Mat> faces = cropFaces(imagePaths);
+    if (faces.empty()) {
+        return 0;
+    }
+
+    int label = labelOf(personName, true);
+    if (gallery.add(faces, label) < 0 || !save()) {
+        return -1;
+    }
+    std::cout << "[INFO] Enrolled " << faces.size() << " face(s) of " << personName << std::endl;
+    return static_cast<int>(faces.size());
+}
+
+/// @brief Enroll a person again from their dataset folder, after images were removed from it
+/**
+ * @param personName Name of the person.
+ * @param personDir The person's dataset folder. If it holds no usable image, the person is removed.
+ * @return The number of faces now enrolled for the person, or -1 if the gallery could not be loaded or saved.
+ *
+ * The person's rows are compacted out of the gallery and the images left in the folder are enrolled again, so the
+ * work is proportional to this one person's images rather than to the dataset.
+ */
+int FaceEnroller::reenroll(const std::string& personName, const std::string& personDir) {
+    if (!load()) {
+        return -1;
+    }
+    std::vector<std::string> imagePaths;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(personDir, error)) {
+        if (entry.is_regular_file()) {
+            imagePaths.push_back(entry.path().string());
+        }
+    }
+    std::vector<cv::Mat> faces = cropFaces(imagePaths);
+
+    int label = labelOf(personName, !faces.empty());
+    if (label < 0) {
+        return 0;
+    }
+    int removed = gallery.removeLabel(label);
+    if (faces.empty()) {
+        names.erase(label);
+        std::cout << "[INFO] Removed " << personName << ", no usable image is left" << std::endl;
+    } else if (gallery.add(faces, label) < 0) {
+        return -1;
+    }
+    if (!save()) {
+        return -1;
+    }
+    std::cout << "[INFO] Re-enrolled " << personName << ": " << removed << " face(s) before, " << faces.size()
+              << " now" << std::endl;
+    return static_cast<int>(faces.size());
+}
+
+/// @brief Read an image and crop its face the way training does
+/**
+ * @param detector Detector configured from detector.yml.
+ * @param preprocessor Preprocessor configured from preprocess.yml, as used by live recognition.
+ * @param imagePath Image to read.
+ * @param face Receives the first detected face, grayscale and preprocessed.
+ * @return true if a face was found, false if the image is unreadable or holds no face.
+ */
+bool FaceEnroller::cropFace(FaceDetector& detector, FacePreprocessor& preprocessor, const std::string& imagePath,
+                            cv::Mat& face) {
+    cv::Mat image = cv::imread(imagePath);
+    if (image.empty()) {
+        std::cerr << "Warning: Could not read image " << imagePath << std::endl;
+        return false;
+    }
+    cv::Mat gray;
+    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    std::vector<cv::Rect> faces = detector.detectFaces(gray);
+    if (faces.empty()) {
+        std::cerr << "Warning: No face detected in " << imagePath << std::endl;
+        return false;
+    }
+    preprocessor.apply(gray(faces[0]), face);
+    return true;
+}
+
+/// @brief Load the gallery and label names, and the detector and preprocessing settings on first use
+bool FaceEnroller::load() {
+    if (!detectorLoaded) {
+        preprocessor = FacePreprocessor(loadPreprocessConfig(root + "/textfiles/preprocess.yml"));
+        detectorLoaded = detector.loadConfig(root + "/textfiles/detector.yml", root);
+        if (!detectorLoaded) {
+            std::cerr << "Error: Unable to load the face detector" << std::endl;
+            return false;
+        }
+    }
+    // Read again on every change, training or another enroller may have replaced the files meanwhile
+    if (!gallery.read(galleryPath)) {
+        std::cerr << "Error: No gallery at " << galleryPath << ", train the model first" << std::endl;
+        return false;
+    }
+    names.clear();
+    std::ifstream labelsFile(labelsPath);
+    int id;
+    std::string name;
+    while (labelsFile >> id >> name) {
+        names[id] = name;
+    }
+    return true;
+}
+
+/// @brief Write the gallery, then labels.txt, each replacing the old file in one rename
+bool FaceEnroller::save() const {
+    if (!gallery.write(galleryPath)) {
+        return false;
+    }
+    std::string temporary = labelsPath + ".tmp";
+    std::ofstream labelsFile(temporary, std::ios::trunc);
+    if (!labelsFile.is_open()) {
+        std::cerr << "Error: Unable to open " << temporary << " for writing." << std::endl;
+        return false;
+    }
+    for (const auto& entry : names) {
+        labelsFile << entry.first << " " << entry.second << std::endl;
+    }
+    labelsFile.close();
+    std::error_code error;
+    fs::rename(temporary, labelsPath, error);
+    if (!labelsFile || error) {
+        std::cerr << "Error: Unable to replace " << labelsPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// @brief Label of a person in labels.txt, optionally assigning a label never used before to a new person
+/**
+ * The gallery remembers the highest label it ever held, so the label of a removed person is not handed out again.
+ */
+int FaceEnroller::labelOf(const std::string& personName, bool create) {
+    for (const auto& entry : names) {
+        if (entry.second == personName) {
+            return entry.first;
+        }
+    }
+    if (!create) {
+        return -1;
+    }
+    int label = std::max(gallery.nextLabel(), names.empty() ? 0 : names.rbegin()->first + 1);
+    names[label] = personName;
+    std::cout << "[INFO] Enrolling new person " << personName << " as label " << label << std::endl;
+    return label;
+}
+
+/// @brief Crop the face of every readable image that has one
+std::vector<cv::Mat> FaceEnroller::cropFaces(const std::vector<std::string>& imagePaths) {
+    std::vector<cv::Mat> faces;
+    for (const auto& imagePath : imagePaths) {
+        cv::Mat face;
+        if (cropFace(detector, preprocessor, imagePath, face)) {
+            faces.push_back(face);
+        }
+    }
+    return faces;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "FaceDetector.h"
+#include "FacePreprocessor.h"
+#include "LbphGallery.h"
+
+
+/// @brief Applies changes to one person's images to the trained gallery without retraining the whole dataset.
+/**
+ * A full training run re-reads and re-detects every image of every person. LBPH simply keeps one histogram per
+ * training image, so adding images only needs the histograms of the new images, and deleting images only needs the
+ * rows of that one person dropped and their remaining images enrolled again. The enroller does exactly that on
+ * recognizer/gallery.bin and recognizer/labels.txt, and the running programs pick the result up by reloading the
+ * gallery.
+ *
+ * A new person gets a label that was never used, not even by a person removed since (see
+ * LbphGallery::nextLabel()). embeddings.xml is not touched, it only catches up at the next full
+ * training, which also renumbers the labels in dataset order.
+ *
+ * @file FaceEnroller.h
+ */
+class FaceEnroller {
+public:
+    /// @brief Set up the enroller for a project directory
+    /**
+     * @param rootDir Project root holding textfiles/detector.yml, textfiles/preprocess.yml and the recognizer
+     *                directory.
+     */
+    explicit FaceEnroller(const std::string& rootDir);
+
+    /// @brief Enroll new images of a person, creating the person if they are not enrolled yet
+    /**
+     * @param personName Name of the person, the name of their dataset folder.
+     * @param imagePaths Images to enroll.
+     * @return The number of faces enrolled, or -1 if the gallery could not be loaded or saved.
+     */
+    int addImages(const std::string& personName, const std::vector<std::string>& imagePaths);
+
+    /// @brief Enroll a person again from their dataset folder, after images were removed from it
+    /**
+     * @param personName Name of the person.
+     * @param personDir The person's dataset folder. If it holds no usable image, the person is removed.
+     * @return The number of faces now enrolled for the person, or -1 if the gallery could not be loaded or saved.
+     */
+    int reenroll(const std::string& personName, const std::string& personDir);
+
+    /// @brief Read an image and crop its face the way training does
+    /**
+     * @param detector Detector configured from detector.yml.
+     * @param preprocessor Preprocessor configured from preprocess.yml, as used by live recognition.
+     * @param imagePath Image to read.
+     * @param face Receives the first detected face, grayscale and preprocessed.
+     * @return true if a face was found, false if the image is unreadable or holds no face.
+     */
+    static bool cropFace(FaceDetector& detector, FacePreprocessor& preprocessor, const std::string& imagePath,
+                         cv::Mat& face);
+
+private:
+    bool load();
+    bool save() const;
+    int labelOf(const std::string& personName, bool create);
+    std::vector<cv::Mat> cropFaces(const std::vector<std::string>& imagePaths);
+
+    std::string root;
+    std::string galleryPath;
+    std::string labelsPath;
+    FaceDetector detector;
+    bool detectorLoaded = false;
+    FacePreprocessor preprocessor;
+    LbphGallery gallery;
+    std::map<int, std::string> names;  ///< Label to person name, as in labels.txt
+};
@@ -0,0 +1,96 @@
+#include "FacePreprocessor.h"
+#include <algorithm>
+#include <iostream>
+
+/**
+ * @brief Turns a detected face into the fixed-size crop the recognizer is trained and queried with.
+ * @file FacePreprocessor.cpp
+ */
+
+/// @brief Read the preprocessing settings
+/**
+ * @param configPath Path to preprocess.yml with the keys size, normalization (none, equalize or clahe), clipLimit and
+ *                   tileGrid. Missing keys keep their defaults.
+ * @return The settings; the defaults (100x100, no normalization) if the file is missing.
+ */
+PreprocessParams loadPreprocessConfig(const std::string& configPath) {
+    PreprocessParams params;
+    cv::FileStorage config;
+    try {
+        config.open(configPath, cv::FileStorage::READ);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error reading preprocessing config " << configPath << ": " << e.what() << std::endl;
+    }
+    if (!config.isOpened()) {
+        return params;
+    }
+    auto read = [&config](const char* key, auto& value) {
+        cv::FileNode node = config[key];
+        if (!node.empty()) {
+            node >> value;
+        }
+    };
+    std::string normalization = "none";
+    read("size", params.size);
+    read("normalization", normalization);
+    read("clipLimit", params.clipLimit);
+    read("tileGrid", params.tileGrid);
+    params.size = std::max(params.size, 16);
+    params.tileGrid = std::max(params.tileGrid, 1);
+    if (normalization == "equalize") {
+        params.normalization = FaceNormalization::Equalize;
+    } else if (normalization == "clahe") {
+        params.normalization = FaceNormalization::Clahe;
+    } else if (normalization != "none") {
+        std::cerr << "Warning: Unknown normalization " << normalization << " in " << configPath << ", using none"
+                  << std::endl;
+    }
+    return params;
+}
+
+/// @brief Constructor takes the settings, the defaults match models trained before the preprocessor existed
+FacePreprocessor::FacePreprocessor(const PreprocessParams& params)
+    : parameters(params) {
+}
+
+/// @brief Copies the settings only; the copy creates its own buffers
+FacePreprocessor::FacePreprocessor(const FacePreprocessor& other)
+    : parameters(other.parameters) {
+}
+
+/// @brief Copies the settings only; buffers of this instance are dropped
+FacePreprocessor& FacePreprocessor::operator=(const FacePreprocessor& other) {
+    parameters = other.parameters;
+    clahe.reset();
+    resized.release();
+    return *this;
+}
+
+/// @brief Preprocess a face
+/**
+ * @param grayFace Grayscale face region, any size.
+ * @param output Receives the size x size crop. Its buffer is reused when it already has that size.
+ *
+ * The crop is resized with bilinear interpolation, as training always did, so models trained before keep matching.
+ */
+void FacePreprocessor::apply(const cv::Mat& grayFace, cv::Mat& output) {
+    cv::Size size(parameters.size, parameters.size);
+    if (parameters.normalization == FaceNormalization::None) {
+        cv::resize(grayFace, output, size);
+        return;
+    }
+    cv::resize(grayFace, resized, size);
+    if (parameters.normalization == FaceNormalization::Equalize) {
+        cv::equalizeHist(resized, output);
+        return;
+    }
+    if (!clahe) {
+        clahe = cv::createCLAHE(parameters.clipLimit, cv::Size(parameters.tileGrid, parameters.tileGrid));
+    }
+    clahe->apply(resized, output);
+}
+
+/// @brief The settings in use
+const PreprocessParams& FacePreprocessor::params() const {
+    return parameters;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+
+/// @brief Lighting normalization applied to a face crop after resizing
+enum class FaceNormalization {
+    None,       ///< Leave the pixels as they are
+    Equalize,   ///< Global histogram equalization
+    Clahe       ///< Contrast-limited adaptive histogram equalization, robust to light from one side
+};
+
+
+/// @brief Settings shared by training and live recognition, read from textfiles/preprocess.yml
+struct PreprocessParams {
+    int size = 100;                                       ///< Side of the square crop passed to the recognizer
+    FaceNormalization normalization = FaceNormalization::None;
+    double clipLimit = 2.0;                               ///< CLAHE contrast limit
+    int tileGrid = 8;                                     ///< CLAHE tiles per side
+};
+
+
+/// @brief Read the preprocessing settings
+/**
+ * @param configPath Path to preprocess.yml with the keys size, normalization (none, equalize or clahe), clipLimit and
+ *                   tileGrid. Missing keys keep their defaults.
+ * @return The settings; the defaults (100x100, no normalization) if the file is missing.
+ */
+PreprocessParams loadPreprocessConfig(const std::string& configPath);
+
+
+/// @brief Turns a detected face into the fixed-size crop the recognizer is trained and queried with.
+/**
+ * Training and live recognition both pass every face through the same preprocessor, so histograms are always
+ * computed on crops of the same size and lighting normalization as the enrolled ones. Detected faces range from
+ * 60x60 to 350x350 pixels; resizing them first also makes the cost of a prediction constant.
+ *
+ * The output and scratch buffers are reused from call to call, so a preprocessor running on the same crop size
+ * allocates nothing after its first face. An instance is not safe to use from several threads at once; each thread
+ * or pipeline owns its own.
+ *
+ * @file FacePreprocessor.h
+ */
+class FacePreprocessor {
+public:
+    /// @brief Constructor takes the settings, the defaults match models trained before the preprocessor existed
+    explicit FacePreprocessor(const PreprocessParams& params = PreprocessParams());
+
+    /// @brief Copies the settings only; the copy creates its own buffers
+    FacePreprocessor(const FacePreprocessor& other);
+
+    /// @brief Copies the settings only; buffers of this instance are dropped
+    FacePreprocessor& operator=(const FacePreprocessor& other);
+
+    /// @brief Preprocess a face
+    /**
+     * @param grayFace Grayscale face region, any size.
+     * @param output Receives the size x size crop. Its buffer is reused when it already has that size.
+     */
+    void apply(const cv::Mat& grayFace, cv::Mat& output);
+
+    /// @brief The settings in use
+    const PreprocessParams& params() const;
+
+private:
+    PreprocessParams parameters;
+    cv::Ptr<cv::CLAHE> clahe;   ///< Created on first use; holds per-instance scratch buffers
+    cv::Mat resized;
+};
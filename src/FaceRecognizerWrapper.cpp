@@ -1,4 +1,5 @@
 #include "FaceRecognizerWrapper.h"
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 
@@ -26,7 +27,8 @@
      * @note The default values are the same as those used in the OpenCV LBPHFaceRecognizer.
      */
 FaceRecognizerWrapper::FaceRecognizerWrapper(int radius, int neighbors,
-    int grid_x, int grid_y, double threshold) {
+    int grid_x, int grid_y, double threshold)
+    : gallery(std::make_shared<LbphGallery>()) {
     // Create LBPHFaceRecognizer with custom parameters
     recognizer = cv::face::LBPHFaceRecognizer::create(radius, neighbors, grid_x, grid_y, threshold);
 }
@@ -34,7 +36,7 @@ FaceRecognizerWrapper::FaceRecognizerWrapper(int radius, int neighbors,
 /// @brief Load the trained model (embeddings.xml)
 /**
  * Loads a pre-trained face recognition model from a file. If the model file is not found or cannot be read,
- * an error message is printed to the console.
+ * an error message is printed to the console. The gallery is rebuilt from the loaded histograms.
  */
 void FaceRecognizerWrapper::loadModel(const std::string& modelPath) {
     try {
@@ -42,7 +44,34 @@ void FaceRecognizerWrapper::loadModel(const std::string& modelPath) {
     }
     catch (cv::Exception& e) {
         std::cerr << "Error loading model: " << e.what() << std::endl;
+        return;
     }
+    auto built = std::make_shared<LbphGallery>();
+    built->build(*recognizer);
+    std::atomic_store(&gallery, std::shared_ptr<const LbphGallery>(std::move(built)));
+}
+
+/// @brief Load a compact gallery (gallery.bin) written by training instead of the full model
+/**
+ * The gallery holds everything predict() needs in a fraction of the size of embeddings.xml, and is mapped
+ * read-only rather than parsed, so it opens almost instantly and is shared by all processes on the host. The
+ * OpenCV model is left unloaded, so setGalleryEnabled(false) has no effect afterwards.
+ *
+ * Safe to call while other threads predict: the gallery is loaded on the side and then swapped in atomically.
+ *
+ * @param galleryPath Path to gallery.bin.
+ * @return true if the gallery was loaded, false if the file is missing or unreadable.
+ */
+bool FaceRecognizerWrapper::loadGallery(const std::string& galleryPath) {
+    if (!std::filesystem::exists(galleryPath)) {
+        return false;
+    }
+    auto loaded = std::make_shared<LbphGallery>();
+    if (!loaded->read(galleryPath)) {
+        return false;
+    }
+    std::atomic_store(&gallery, std::shared_ptr<const LbphGallery>(std::move(loaded)));
+    return true;
 }
 
 ///@brief Load the label mapping from labels.txt
@@ -75,12 +104,39 @@ void FaceRecognizerWrapper::loadLabels(const std::string& labelsPath) {
  * @return The predicted label for the face ROI
  */
 int FaceRecognizerWrapper::predict(const cv::Mat& faceROI, double& confidence) const {
+    std::shared_ptr<const LbphGallery> snapshot = std::atomic_load(&gallery);
+    if (galleryEnabled && !snapshot->empty()) {
+        return snapshot->predict(faceROI, confidence);
+    }
     int predictedLabel = -1;
     // This call sets both the predicted label and confidence
     recognizer->predict(faceROI, predictedLabel, confidence);
     return predictedLabel;
 }
 
+///@brief Predict the labels of all faces of a frame at once
+/**
+ * Gives each face the label and confidence predict() would give it, but computes the histograms of all faces in
+ * parallel and matches them against the gallery together, in one pass over the enrolled histograms.
+ *
+ * @param faceROIs The cropped face images of one frame
+ * @param predictedLabels Receives the predicted label of each face, -1 where the prediction fails
+ * @param confidences Receives the confidence level of each face
+ */
+void FaceRecognizerWrapper::predictBatch(const std::vector<cv::Mat>& faceROIs, std::vector<int>& predictedLabels,
+                                         std::vector<double>& confidences) const {
+    std::shared_ptr<const LbphGallery> snapshot = std::atomic_load(&gallery);
+    if (galleryEnabled && !snapshot->empty()) {
+        snapshot->predictBatch(faceROIs, predictedLabels, confidences);
+        return;
+    }
+    predictedLabels.assign(faceROIs.size(), -1);
+    confidences.assign(faceROIs.size(), 0.0);
+    for (std::size_t i = 0; i < faceROIs.size(); i++) {
+        recognizer->predict(faceROIs[i], predictedLabels[i], confidences[i]);
+    }
+}
+
 ///@brief Get the name associated with a label
 /**
  * Retrieves the name associated with a given label. If the label is not found in the mapping, "Unknown" is returned.
@@ -94,4 +150,19 @@ std::string FaceRecognizerWrapper::getLabelName(int label) const {
         return it->second;
     }
     return "Unknown";
-}
\ No newline at end of file
+}
+
+///@brief Choose between the gallery and OpenCV's own LBPH predict
+/**
+ * The gallery is used by default; turning it off is only useful to compare the two, as the benchmark does.
+ *
+ * @param enabled true to match with the gallery, false to call LBPHFaceRecognizer::predict
+ */
+void FaceRecognizerWrapper::setGalleryEnabled(bool enabled) {
+    galleryEnabled = enabled;
+}
+
+///@brief The current gallery snapshot, built from the loaded model or mapped from gallery.bin
+std::shared_ptr<const LbphGallery> FaceRecognizerWrapper::getGallery() const {
+    return std::atomic_load(&gallery);
+}
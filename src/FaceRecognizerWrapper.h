@@ -3,7 +3,12 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/face.hpp>
 #include <string>
+#include <atomic>
 #include <map>
+#include <memory>
+#include <vector>
+
+#include "LbphGallery.h"
 
 
 /// @brief Provides a wrapper for OpenCV's Face recognizer as well as managing label-to-name mapping.
@@ -12,6 +17,16 @@
  * face data and its corresponding face mapping. When a face is detected, it is passed to the predict method, which
  * returns the predicted label's name and its confidence level.
  *
+ * Once the model and labels are loaded, predict(), predictBatch() and getLabelName() only read from the recognizer,
+ * so a single loaded instance can be shared (as a const object) by several camera pipelines at once. They take no
+ * lock: each call matches against an immutable gallery snapshot with buffers private to the calling thread, so
+ * concurrent predictions scale with the number of cores. loadGallery() may run while other threads predict; it
+ * publishes a new snapshot atomically and calls already running finish on the previous one. The other load
+ * functions and setGalleryEnabled() are setup calls that must finish before the instance is shared.
+ *
+ * Predictions are matched by an LbphGallery built from the loaded model, which returns the same label and distance
+ * as OpenCV's LBPH predict but scans all enrolled histograms in one contiguous buffer with SIMD.
+ *
  * @file FaceRecognizerWrapper.h
  * @author Naween Sawari
  */
@@ -45,6 +60,17 @@ public:
      */
     void loadModel(const std::string& modelPath);
 
+    /// @brief Load a compact gallery (gallery.bin) written by training instead of the full model
+    /**
+     * The gallery holds everything predict() needs in a fraction of the size of embeddings.xml, and is mapped
+     * read-only rather than parsed, so it opens almost instantly and is shared by all processes on the host. The
+     * OpenCV model is left unloaded, so setGalleryEnabled(false) has no effect afterwards.
+     *
+     * @param galleryPath Path to gallery.bin.
+     * @return true if the gallery was loaded, false if the file is missing or unreadable.
+     */
+    bool loadGallery(const std::string& galleryPath);
+
     ///@brief Load the label mapping from labels.txt
     /**
      * Loads the label-to-name mapping from a text file. Each line in the file should contain an integer label
@@ -64,6 +90,18 @@ public:
      */
     int predict(const cv::Mat& faceROI, double& confidence) const;
 
+    ///@brief Predict the labels of all faces of a frame at once
+    /**
+     * Gives each face the label and confidence predict() would give it, but computes the histograms of all faces in
+     * parallel and matches them against the gallery together, in one pass over the enrolled histograms.
+     *
+     * @param faceROIs The cropped face images of one frame
+     * @param predictedLabels Receives the predicted label of each face, -1 where the prediction fails
+     * @param confidences Receives the confidence level of each face
+     */
+    void predictBatch(const std::vector<cv::Mat>& faceROIs, std::vector<int>& predictedLabels,
+                      std::vector<double>& confidences) const;
+
     ///@brief Get the name associated with a label
     /**
      * Retrieves the name associated with a given label. If the label is not found in the mapping, "Unknown" is returned.
@@ -73,7 +111,20 @@ public:
      */
     std::string getLabelName(int label) const;
 
+    ///@brief Choose between the gallery and OpenCV's own LBPH predict
+    /**
+     * The gallery is used by default; turning it off is only useful to compare the two, as the benchmark does.
+     *
+     * @param enabled true to match with the gallery, false to call LBPHFaceRecognizer::predict
+     */
+    void setGalleryEnabled(bool enabled);
+
+    ///@brief The current gallery snapshot, built from the loaded model or mapped from gallery.bin
+    std::shared_ptr<const LbphGallery> getGallery() const;
+
 private:
     cv::Ptr<cv::face::LBPHFaceRecognizer> recognizer;
+    std::shared_ptr<const LbphGallery> gallery;   ///< Never null; only accessed through std::atomic_load/store
+    std::atomic<bool> galleryEnabled{true};
     std::map<int, std::string> labels;
 };
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "FaceTracker.h"
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+/**
+ * @brief Follows detected faces between detector runs so the detector only runs every N frames.
+ * @file FaceTracker.cpp
+ */
+
+namespace {
+
+/// Width in pixels the appearance patch is scaled to; matching cost grows with its square
+const int kPatchWidth = 24;
+
+/// Minimum normalized correlation for a propagated position to count as the same face
+const double kMinMatchScore = 0.5;
+
+/// Minimum overlap for a detection to be associated with an existing track
+const double kMinOverlap = 0.3;
+
+/// Detection passes an unconfirmed track survives while it can still be followed
+const int kMaxMisses = 2;
+
+/// Intersection over union of two boxes
+double overlap(const cv::Rect& a, const cv::Rect& b) {
+    double intersection = (a & b).area();
+    double unionArea = a.area() + b.area() - intersection;
+    return unionArea > 0.0 ? intersection / unionArea : 0.0;
+}
+
+}
+
+/// @brief Constructor sets how often the detector runs
+/**
+ * @param detectInterval Run the detector on one frame out of this many. 1 detects on every frame.
+ */
+FaceTracker::FaceTracker(int detectInterval)
+    : detectInterval(std::max(1, detectInterval)) {
+}
+
+/// @brief Change how often the detector runs
+void FaceTracker::setDetectInterval(int interval) {
+    detectInterval = std::max(1, interval);
+}
+
+/// @brief Change how many detection passes may pass between two full-frame scans
+void FaceTracker::setFullScanInterval(int passes) {
+    fullScanInterval = std::max(1, passes);
+}
+
+/// @brief Whether the caller should run the detector on the next frame
+bool FaceTracker::detectionDue() const {
+    return forceDetection || framesSinceDetection + 1 >= detectInterval;
+}
+
+/// @brief Whether the next detection pass must scan the whole frame rather than the regions around the tracks
+bool FaceTracker::fullScanDue() const {
+    return forceFullScan || currentTracks.empty() || passesSinceFullScan + 1 >= fullScanInterval;
+}
+
+/// @brief The current track boxes, to be searched by a region scan
+std::vector<cv::Rect> FaceTracker::regions() const {
+    std::vector<cv::Rect> boxes;
+    boxes.reserve(currentTracks.size());
+    for (const auto& track : currentTracks) {
+        boxes.push_back(track.rect);
+    }
+    return boxes;
+}
+
+/// @brief Feed the detector's output for the current frame
+/**
+ * @param gray The grayscale frame the detections come from.
+ * @param detections Face boxes reported by the detector.
+ * @param fullScan Whether the detections come from a full-frame scan rather than a region scan.
+ *
+ * Associations are made greedily, best overlap first, which is enough for the handful of faces a door camera sees.
+ */
+void FaceTracker::update(const cv::Mat& gray, const std::vector<cv::Rect>& detections, bool fullScan) {
+    framesSinceDetection = 0;
+    forceDetection = false;
+    if (fullScan) {
+        passesSinceFullScan = 0;
+        forceFullScan = false;
+    } else {
+        passesSinceFullScan++;
+    }
+
+    std::vector<bool> followed(currentTracks.size());
+    for (std::size_t t = 0; t < currentTracks.size(); t++) {
+        followed[t] = follow(gray, currentTracks[t]);
+    }
+
+    std::vector<std::tuple<double, std::size_t, std::size_t>> candidates;
+    for (std::size_t d = 0; d < detections.size(); d++) {
+        for (std::size_t t = 0; t < currentTracks.size(); t++) {
+            double score = overlap(detections[d], currentTracks[t].rect);
+            if (score >= kMinOverlap) {
+                candidates.emplace_back(score, d, t);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+
+    std::vector<bool> detectionUsed(detections.size(), false);
+    std::vector<bool> trackMatched(currentTracks.size(), false);
+    for (const auto& [score, d, t] : candidates) {
+        if (detectionUsed[d] || trackMatched[t]) {
+            continue;
+        }
+        detectionUsed[d] = true;
+        trackMatched[t] = true;
+        FaceTrack& track = currentTracks[t];
+        track.rect = detections[d];
+        track.detected = true;
+        track.misses = 0;
+        capture(gray, track);
+    }
+
+    std::vector<FaceTrack> kept;
+    for (std::size_t t = 0; t < currentTracks.size(); t++) {
+        FaceTrack& track = currentTracks[t];
+        if (!trackMatched[t]) {
+            if (!fullScan) {
+                forceDetection = true;
+                forceFullScan = true;
+            }
+            track.detected = false;
+            track.misses++;
+            if (!followed[t] || track.misses > kMaxMisses) {
+                continue;
+            }
+        }
+        kept.push_back(std::move(track));
+    }
+    for (std::size_t d = 0; d < detections.size(); d++) {
+        if (detectionUsed[d]) {
+            continue;
+        }
+        FaceTrack track;
+        track.id = nextId++;
+        track.rect = detections[d];
+        track.detected = true;
+        capture(gray, track);
+        kept.push_back(std::move(track));
+    }
+    currentTracks = std::move(kept);
+}
+
+/// @brief Follow every track to the current frame without running the detector
+/**
+ * @param gray The grayscale frame.
+ * @return false if a track was lost, in which case detectionDue() is true for the next frame.
+ */
+bool FaceTracker::propagate(const cv::Mat& gray) {
+    framesSinceDetection++;
+    bool allFollowed = true;
+    for (auto it = currentTracks.begin(); it != currentTracks.end();) {
+        it->detected = false;
+        if (follow(gray, *it)) {
+            ++it;
+        } else {
+            it = currentTracks.erase(it);
+            allFollowed = false;
+        }
+    }
+    if (!allFollowed) {
+        forceDetection = true;
+    }
+    return allFollowed;
+}
+
+/// @brief The faces currently tracked
+const std::vector<FaceTrack>& FaceTracker::tracks() const {
+    return currentTracks;
+}
+
+/// @brief Forget every track and run the detector on the next frame
+void FaceTracker::reset() {
+    currentTracks.clear();
+    framesSinceDetection = 0;
+    passesSinceFullScan = 0;
+    forceDetection = true;
+    forceFullScan = true;
+}
+
+/// @brief Move a track to where its appearance patch matches best, within half a face of its last position
+/**
+ * @return false if the face left the frame or no position matches well enough.
+ */
+bool FaceTracker::follow(const cv::Mat& gray, FaceTrack& track) const {
+    if (track.appearance.empty()) {
+        return false;
+    }
+    cv::Rect frameRect(0, 0, gray.cols, gray.rows);
+    int padX = track.rect.width / 2;
+    int padY = track.rect.height / 2;
+    cv::Rect search = cv::Rect(track.rect.x - padX, track.rect.y - padY,
+                               track.rect.width + 2 * padX, track.rect.height + 2 * padY) & frameRect;
+    if (search.width < track.rect.width || search.height < track.rect.height) {
+        return false;
+    }
+
+    cv::Mat window;
+    cv::resize(gray(search), window, cv::Size(), track.scale, track.scale, cv::INTER_AREA);
+    if (window.cols < track.appearance.cols || window.rows < track.appearance.rows) {
+        return false;
+    }
+    cv::Mat scores;
+    cv::matchTemplate(window, track.appearance, scores, cv::TM_CCOEFF_NORMED);
+    double best = 0.0;
+    cv::Point bestLoc;
+    cv::minMaxLoc(scores, nullptr, &best, nullptr, &bestLoc);
+    if (best < kMinMatchScore) {
+        return false;
+    }
+
+    track.rect.x = search.x + static_cast<int>(std::lround(bestLoc.x / track.scale));
+    track.rect.y = search.y + static_cast<int>(std::lround(bestLoc.y / track.scale));
+    track.rect &= frameRect;
+    return !track.rect.empty();
+}
+
+/// @brief Store a downscaled copy of the face under the track's box for matching on later frames
+void FaceTracker::capture(const cv::Mat& gray, FaceTrack& track) const {
+    track.rect &= cv::Rect(0, 0, gray.cols, gray.rows);
+    if (track.rect.empty()) {
+        track.appearance.release();
+        return;
+    }
+    track.scale = std::min(1.0, static_cast<double>(kPatchWidth) / track.rect.width);
+    cv::resize(gray(track.rect), track.appearance, cv::Size(), track.scale, track.scale, cv::INTER_AREA);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+
+/// @brief A face followed across frames
+struct FaceTrack {
+    int id = 0;               ///< Stable identifier, unique for the lifetime of the tracker
+    cv::Rect rect;            ///< Current bounding box in full-frame coordinates
+    bool detected = false;    ///< Whether the box came from the detector on this frame rather than from tracking
+    int misses = 0;           ///< Consecutive detection passes that did not confirm this track
+    cv::Mat appearance;       ///< Downscaled grayscale patch from the last detection, matched between detections
+    double scale = 1.0;       ///< Factor applied to the frame before matching the appearance patch
+};
+
+
+/// @brief Follows detected faces between detector runs so the detector only runs every N frames.
+/**
+ * Haar detection over the whole frame is the most expensive step of the pipeline, but on a steady scene faces move
+ * by a few pixels per frame. The tracker lets the caller run the detector only when detectionDue() says so: every
+ * N frames, or straight away when a track has been lost. On the frames in between, propagate() moves every track
+ * by matching the face patch from its last detection against a small search window around its previous position.
+ * Matching is done on a downscaled copy, so following a face costs a tiny fraction of a detection pass.
+ *
+ * Detections are associated with existing tracks by overlap, so a face keeps its track ID for as long as it is
+ * followed; faces the detector reports that match no track get a new ID.
+ *
+ * Detection passes come in two kinds. A full scan searches the whole frame; a region scan only searches around the
+ * current tracks (FaceDetector::detectAround). fullScanDue() asks for a full scan when nothing is tracked, every few
+ * detection passes so newcomers are picked up, and right after a region scan failed to confirm a track.
+ *
+ * @file FaceTracker.h
+ */
+class FaceTracker {
+public:
+    /// @brief Constructor sets how often the detector runs
+    /**
+     * @param detectInterval Run the detector on one frame out of this many. 1 detects on every frame.
+     */
+    explicit FaceTracker(int detectInterval = 5);
+
+    /// @brief Change how often the detector runs
+    void setDetectInterval(int interval);
+
+    /// @brief Change how many detection passes may pass between two full-frame scans
+    void setFullScanInterval(int passes);
+
+    /// @brief Whether the caller should run the detector on the next frame
+    bool detectionDue() const;
+
+    /// @brief Whether the next detection pass must scan the whole frame rather than the regions around the tracks
+    bool fullScanDue() const;
+
+    /// @brief The current track boxes, to be searched by a region scan
+    std::vector<cv::Rect> regions() const;
+
+    /// @brief Feed the detector's output for the current frame
+    /**
+     * @param gray The grayscale frame the detections come from.
+     * @param detections Face boxes reported by the detector.
+     * @param fullScan Whether the detections come from a full-frame scan rather than a region scan.
+     *
+     * Existing tracks are first propagated to this frame, then matched to the detections by overlap. Matched tracks
+     * take the detected box and a fresh appearance patch. Unmatched detections start new tracks; unmatched tracks
+     * are kept for a short grace period while they can still be followed, then dropped. A region scan that leaves a
+     * track unconfirmed schedules a full scan on the next frame.
+     */
+    void update(const cv::Mat& gray, const std::vector<cv::Rect>& detections, bool fullScan = true);
+
+    /// @brief Follow every track to the current frame without running the detector
+    /**
+     * @param gray The grayscale frame.
+     * @return false if a track was lost, in which case detectionDue() is true for the next frame.
+     */
+    bool propagate(const cv::Mat& gray);
+
+    /// @brief The faces currently tracked
+    const std::vector<FaceTrack>& tracks() const;
+
+    /// @brief Forget every track and run the detector on the next frame
+    void reset();
+
+private:
+    bool follow(const cv::Mat& gray, FaceTrack& track) const;
+    void capture(const cv::Mat& gray, FaceTrack& track) const;
+
+    int detectInterval;
+    int fullScanInterval = 6;
+    int framesSinceDetection = 0;
+    int passesSinceFullScan = 0;
+    bool forceDetection = true;
+    bool forceFullScan = true;
+    int nextId = 1;
+    std::vector<FaceTrack> currentTracks;
+};
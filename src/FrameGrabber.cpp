@@ -0,0 +1,161 @@
+#include "FrameGrabber.h"
+#include <iostream>
+#include <utility>
+
+/**
+ * @brief Reads frames from a source on a dedicated thread and publishes them into a drop-oldest ring.
+ * @file FrameGrabber.cpp
+ */
+
+/// @brief Constructor sets up the ring buffer
+/**
+ * @param ringCapacity Number of frames kept in the ring before the oldest ones are dropped.
+ */
+FrameGrabber::FrameGrabber(std::size_t ringCapacity)
+    : ring(ringCapacity) {
+}
+
+/// @brief Destructor stops the capture thread and releases the camera
+FrameGrabber::~FrameGrabber() {
+    stop();
+}
+
+/// @brief Open a camera and start the capture thread
+/**
+ * @param deviceIndex Index of the camera to open, as passed to cv::VideoCapture::open.
+ * @return true if the camera was opened and the thread started, false otherwise.
+ *
+ * The camera is opened on the calling thread so that a failure can be reported immediately.
+ */
+bool FrameGrabber::start(int deviceIndex) {
+    return start(std::make_unique<CameraSource>(deviceIndex));
+}
+
+/// @brief Open a source and start the capture thread
+/**
+ * @param newSource The camera or recording to read from.
+ * @param mode How a recording is paced. Ignored for live cameras.
+ * @return true if the source was opened and the thread started, false otherwise.
+ *
+ * The source is opened on the calling thread so that a failure can be reported immediately.
+ */
+bool FrameGrabber::start(std::unique_ptr<FrameSource> newSource, ReplayMode mode) {
+    stop();
+    source = std::move(newSource);
+    if (!source || !source->open()) {
+        source.reset();
+        return false;
+    }
+    replayMode = mode;
+    ring.setLossless(!source->isLive() && mode == ReplayMode::AsFastAsPossible);
+    ring.reopen();
+    finished = false;
+    running = true;
+    worker = std::thread(&FrameGrabber::run, this);
+    return true;
+}
+
+/// @brief Stop the capture thread and release the camera
+/**
+ * The ring is closed first, which wakes consumers blocked on it and releases a lossless producer waiting for room.
+ * A realtime replay waiting for its next frame is woken as well, so stopping never waits out a gap in a recording.
+ */
+void FrameGrabber::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running = false;
+    }
+    wake.notify_all();
+    ring.close();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (source) {
+        source->close();
+        source.reset();
+    }
+}
+
+/// @brief Whether the capture thread is running
+bool FrameGrabber::isRunning() const {
+    return running;
+}
+
+/// @brief Whether a recording has been read to its end
+bool FrameGrabber::isFinished() const {
+    return finished;
+}
+
+/// @brief Set a function that is called on the capture thread after each frame is published
+/**
+ * @param callback Function to call, it must be cheap and thread-safe. Must be set before start().
+ */
+void FrameGrabber::setFrameCallback(std::function<void()> callback) {
+    onFrame = std::move(callback);
+}
+
+/// @brief The ring the capture thread publishes into
+FrameRing<TimestampedFrame>& FrameGrabber::frames() {
+    return ring;
+}
+
+/// @brief Capture loop run on the worker thread
+/**
+ * Each iteration reads into a fresh cv::Mat, because consumers may still hold a reference to the previous
+ * frame, stamps it and publishes it. A failed camera read is reported and retried after a short pause; the end
+ * of a recording closes the ring and ends the thread.
+ *
+ * Realtime replays wait until each frame is due relative to the first one, so the pipeline sees the recording at
+ * its original rate; stop() ends the wait early. Lossless replays wait for room in the ring instead of dropping.
+ */
+void FrameGrabber::run() {
+    const bool live = source->isLive();
+    const bool paced = !live && replayMode == ReplayMode::Realtime;
+    std::chrono::steady_clock::time_point replayStart;
+    double firstTimeMs = 0.0;
+    bool first = true;
+
+    while (running) {
+        TimestampedFrame captured;
+        if (!source->read(captured.image, captured.sourceTimeMs)) {
+            if (!live) {
+                std::cout << "[INFO] End of " << source->description() << std::endl;
+                finished = true;
+                ring.close();
+                break;
+            }
+            std::cerr << "Error: blank frame grabbed." << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        if (paced) {
+            if (first) {
+                replayStart = std::chrono::steady_clock::now();
+                firstTimeMs = captured.sourceTimeMs;
+            } else {
+                auto due = replayStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double, std::milli>(captured.sourceTimeMs - firstTimeMs));
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                if (wake.wait_until(lock, due, [this] { return !running; })) {
+                    break;
+                }
+            }
+        }
+        first = false;
+
+        captured.timestamp = std::chrono::steady_clock::now();
+        captured.sequence = nextSequence++;
+        if (ring.isLossless()) {
+            if (!ring.waitPush(captured)) {
+                break;
+            }
+        } else {
+            ring.push(std::move(captured));
+        }
+        if (onFrame) {
+            onFrame();
+        }
+    }
+    running = false;
+}
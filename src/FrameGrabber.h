@@ -0,0 +1,101 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "FrameRing.h"
+#include "FrameSource.h"
+
+
+/// @brief A captured camera frame together with when it was grabbed
+struct TimestampedFrame {
+    cv::Mat image;                                     ///< BGR frame as delivered by the camera
+    std::chrono::steady_clock::time_point timestamp;   ///< Time at which the frame was read
+    std::uint64_t sequence = 0;                        ///< Monotonic frame counter, starting at 1
+    double sourceTimeMs = 0.0;                         ///< Frame time reported by the source, from its start
+};
+
+
+/// @brief Reads frames from a source on a dedicated thread and publishes them into a drop-oldest ring.
+/**
+ * The grabber owns the FrameSource and keeps it off the GUI thread, so a slow detection or recognition pass
+ * never delays the next camera read. Every frame is timestamped and pushed into a FrameRing, which always keeps the
+ * newest frames; consumers pull from the ring and only ever see what the camera is showing now.
+ *
+ * Recordings can be replayed in two ways. ReplayMode::Realtime sleeps until each frame's original timestamp and
+ * keeps the drop-oldest behaviour, so latency numbers match a live camera. ReplayMode::AsFastAsPossible switches
+ * the ring to lossless mode and reads the next frame as soon as there is room for it, so every frame is processed
+ * exactly once and throughput runs are repeatable. When a recording ends the ring is closed.
+ *
+ * @file FrameGrabber.h
+ */
+class FrameGrabber {
+public:
+    /// @brief Constructor sets up the ring buffer
+    /**
+     * @param ringCapacity Number of frames kept in the ring before the oldest ones are dropped.
+     */
+    explicit FrameGrabber(std::size_t ringCapacity = 4);
+
+    /// @brief Destructor stops the capture thread and releases the camera
+    ~FrameGrabber();
+
+    FrameGrabber(const FrameGrabber&) = delete;
+    FrameGrabber& operator=(const FrameGrabber&) = delete;
+
+    /// @brief Open a camera and start the capture thread
+    /**
+     * @param deviceIndex Index of the camera to open, as passed to cv::VideoCapture::open.
+     * @return true if the camera was opened and the thread started, false otherwise.
+     *
+     * The camera is opened on the calling thread so that a failure can be reported immediately.
+     */
+    bool start(int deviceIndex);
+
+    /// @brief Open a source and start the capture thread
+    /**
+     * @param source The camera or recording to read from.
+     * @param mode How a recording is paced. Ignored for live cameras.
+     * @return true if the source was opened and the thread started, false otherwise.
+     */
+    bool start(std::unique_ptr<FrameSource> source, ReplayMode mode = ReplayMode::Realtime);
+
+    /// @brief Stop the capture thread and release the camera
+    void stop();
+
+    /// @brief Whether the capture thread is running
+    bool isRunning() const;
+
+    /// @brief Whether a recording has been read to its end
+    bool isFinished() const;
+
+    /// @brief Set a function that is called on the capture thread after each frame is published
+    /**
+     * @param callback Function to call, it must be cheap and thread-safe. Must be set before start().
+     */
+    void setFrameCallback(std::function<void()> callback);
+
+    /// @brief The ring the capture thread publishes into
+    FrameRing<TimestampedFrame>& frames();
+
+private:
+    void run();
+
+    std::unique_ptr<FrameSource> source;
+    ReplayMode replayMode = ReplayMode::Realtime;
+    FrameRing<TimestampedFrame> ring;
+    std::function<void()> onFrame;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> finished{false};
+    std::mutex wakeMutex;
+    std::condition_variable wake;   ///< Wakes a realtime replay waiting for its next frame when stop() is called
+    std::uint64_t nextSequence = 1;
+};
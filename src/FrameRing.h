@@ -0,0 +1,254 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+
+/// @brief Bounded lock-free ring that always keeps the newest items and drops the oldest ones.
+/**
+ * The ring is a fixed array of slots, each guarded by its own sequence counter, so producers and consumers never
+ * take a lock on the data path. When the ring is full the producer evicts the oldest entry instead of blocking,
+ * which is what a live camera wants: a slow consumer only ever sees the most recent frames.
+ * A ring can instead be switched to lossless mode for replaying recordings, where every item must be processed:
+ * producers then wait for room with waitPush() and consumers using waitNext() take items oldest first.
+ * A mutex/condition variable pair is used solely to put an idle consumer to sleep until something is pushed.
+ *
+ * @tparam T The stored item type. It must be default constructible and movable.
+ * @file FrameRing.h
+ */
+template <typename T>
+class FrameRing {
+public:
+    /// @brief Constructor allocates the slots up front
+    /**
+     * @param capacity Number of slots, rounded up to the next power of two (minimum 2).
+     */
+    explicit FrameRing(std::size_t capacity = 4) {
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        slots.reset(new Slot[size]);
+        for (std::size_t i = 0; i < size; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    /// @brief Publish an item, evicting the oldest entry if the ring is full
+    /**
+     * @param item The item to publish. It is moved into the ring.
+     * @return true if an older item had to be dropped to make room.
+     */
+    bool push(T item) {
+        bool evicted = false;
+        while (!tryPush(item)) {
+            T stale;
+            if (tryPop(stale)) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                evicted = true;
+            }
+        }
+        { std::lock_guard<std::mutex> lock(waitMutex); }
+        waitCondition.notify_all();
+        return evicted;
+    }
+
+    /// @brief Publish an item only if there is room for it
+    /**
+     * @param item The item to publish. It is only moved from when the call succeeds.
+     * @return true if the item was stored, false if the ring is full.
+     */
+    bool tryPush(T& item) {
+        std::size_t pos = writePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[pos & mask];
+            std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(item);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = writePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief Publish an item, waiting for a consumer to make room if the ring is full
+    /**
+     * Used by lossless producers. The data path stays lock-free, so the producer polls for a free slot.
+     *
+     * @param item The item to publish. It is only moved from when the call succeeds.
+     * @return true if the item was stored, false if the ring was closed while waiting.
+     */
+    bool waitPush(T& item) {
+        while (!tryPush(item)) {
+            if (isClosed()) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        { std::lock_guard<std::mutex> lock(waitMutex); }
+        waitCondition.notify_all();
+        return true;
+    }
+
+    /// @brief Take the oldest item in the ring
+    /**
+     * @param out Receives the item on success.
+     * @return true if an item was taken, false if the ring is empty.
+     */
+    bool tryPop(T& out) {
+        std::size_t pos = readPos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[pos & mask];
+            std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (readPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(slot.value);
+                    slot.value = T();
+                    slot.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = readPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief Take the newest item and discard everything older than it
+    /**
+     * @param out Receives the newest item on success.
+     * @return true if at least one item was available.
+     */
+    bool popLatest(T& out) {
+        if (!tryPop(out)) {
+            return false;
+        }
+        T newer;
+        while (tryPop(newer)) {
+            out = std::move(newer);
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /// @brief Block until an item is available, then take the newest one
+    /**
+     * @param out Receives the newest item on success.
+     * @param timeout Maximum time to wait for a producer.
+     * @return true if an item was taken, false on timeout or once the ring is closed and drained.
+     */
+    bool waitPopLatest(T& out, std::chrono::milliseconds timeout) {
+        if (popLatest(out)) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(waitMutex);
+        waitCondition.wait_for(lock, timeout, [this]() { return isClosed() || !empty(); });
+        lock.unlock();
+        return popLatest(out);
+    }
+
+    /// @brief Block until an item is available, then take the oldest one
+    /**
+     * Unlike waitPopLatest() this does not skip anything, which is what a lossless producer expects.
+     *
+     * @param out Receives the oldest item on success.
+     * @param timeout Maximum time to wait for a producer.
+     * @return true if an item was taken, false on timeout or once the ring is closed and drained.
+     */
+    bool waitPop(T& out, std::chrono::milliseconds timeout) {
+        if (tryPop(out)) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(waitMutex);
+        waitCondition.wait_for(lock, timeout, [this]() { return isClosed() || !empty(); });
+        lock.unlock();
+        return tryPop(out);
+    }
+
+    /// @brief Block until an item is available and take the next one according to the ring's mode
+    /**
+     * @param out Receives the newest item, or the oldest one when the ring is lossless.
+     * @param timeout Maximum time to wait for a producer.
+     * @return true if an item was taken, false on timeout or once the ring is closed and drained.
+     */
+    bool waitNext(T& out, std::chrono::milliseconds timeout) {
+        return isLossless() ? waitPop(out, timeout) : waitPopLatest(out, timeout);
+    }
+
+    /// @brief Choose whether consumers may skip items (the default) or must take every one of them
+    void setLossless(bool enabled) {
+        lossless.store(enabled, std::memory_order_release);
+    }
+
+    /// @brief Whether the ring is in lossless mode
+    bool isLossless() const {
+        return lossless.load(std::memory_order_acquire);
+    }
+
+    /// @brief Wake every waiting consumer and make further waits return immediately
+    void close() {
+        closed.store(true, std::memory_order_release);
+        { std::lock_guard<std::mutex> lock(waitMutex); }
+        waitCondition.notify_all();
+    }
+
+    /// @brief Re-arm a ring that was closed so it can be reused
+    void reopen() {
+        closed.store(false, std::memory_order_release);
+    }
+
+    /// @brief Whether close() has been called
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    /// @brief Whether the ring currently holds no items (a snapshot, it may change immediately)
+    bool empty() const {
+        return readPos.load(std::memory_order_acquire) == writePos.load(std::memory_order_acquire);
+    }
+
+    /// @brief Number of slots in the ring
+    std::size_t capacity() const {
+        return mask + 1;
+    }
+
+    /// @brief Total number of items that were discarded because a newer one replaced them
+    std::size_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> sequence{0};
+        T value{};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t mask = 0;
+    alignas(64) std::atomic<std::size_t> writePos{0};
+    alignas(64) std::atomic<std::size_t> readPos{0};
+    alignas(64) std::atomic<std::size_t> dropped{0};
+    std::atomic<bool> closed{false};
+    std::atomic<bool> lossless{false};
+    std::mutex waitMutex;
+    std::condition_variable waitCondition;
+};
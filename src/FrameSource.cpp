@@ -0,0 +1,192 @@
+#include "FrameSource.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+/**
+ * @brief Frame sources for live cameras, video files and directories of images.
+ * @file FrameSource.cpp
+ */
+
+namespace fs = std::filesystem;
+
+/// @brief Create a source from a textual specification
+/**
+ * @param spec A camera index ("0", at most four digits), a path to a video file, or a path to a directory of images.
+ * @return The matching source, not yet opened.
+ */
+std::unique_ptr<FrameSource> FrameSource::create(const std::string& spec) {
+    if (!spec.empty() && spec.size() <= 4 && std::all_of(spec.begin(), spec.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return std::make_unique<CameraSource>(std::stoi(spec));
+    }
+    std::error_code error;
+    if (fs::is_directory(spec, error)) {
+        return std::make_unique<ImageSequenceSource>(spec);
+    }
+    return std::make_unique<VideoFileSource>(spec);
+}
+
+/// @brief Constructor stores the camera index to open
+CameraSource::CameraSource(int deviceIndex)
+    : deviceIndex(deviceIndex) {
+}
+
+/// @brief Open the camera
+bool CameraSource::open() {
+    if (!capture.open(deviceIndex)) {
+        std::cerr << "Error: Could not open camera " << deviceIndex << std::endl;
+        return false;
+    }
+    startTick = static_cast<double>(cv::getTickCount());
+    return true;
+}
+
+/// @brief Read the next frame from the camera, stamped with the time since the camera was opened
+bool CameraSource::read(cv::Mat& frame, double& timestampMs) {
+    frame = cv::Mat();
+    if (!capture.read(frame) || frame.empty()) {
+        return false;
+    }
+    timestampMs = (static_cast<double>(cv::getTickCount()) - startTick) * 1000.0 / cv::getTickFrequency();
+    return true;
+}
+
+/// @brief Release the camera
+void CameraSource::close() {
+    if (capture.isOpened()) {
+        capture.release();
+    }
+}
+
+/// @brief Cameras are live
+bool CameraSource::isLive() const {
+    return true;
+}
+
+/// @brief Describes the source as "camera N"
+std::string CameraSource::description() const {
+    return "camera " + std::to_string(deviceIndex);
+}
+
+/// @brief Constructor stores the path of the video to open
+VideoFileSource::VideoFileSource(std::string path)
+    : path(std::move(path)) {
+}
+
+/// @brief Open the video file and read its frame rate
+/**
+ * The frame rate is only used as a fallback when the container does not report per-frame positions.
+ */
+bool VideoFileSource::open() {
+    if (!capture.open(path)) {
+        std::cerr << "Error: Could not open video " << path << std::endl;
+        return false;
+    }
+    double fps = capture.get(cv::CAP_PROP_FPS);
+    if (fps > 0.0) {
+        frameIntervalMs = 1000.0 / fps;
+    }
+    framesRead = 0;
+    return true;
+}
+
+/// @brief Decode the next frame and report its presentation time
+bool VideoFileSource::read(cv::Mat& frame, double& timestampMs) {
+    frame = cv::Mat();
+    if (!capture.read(frame) || frame.empty()) {
+        return false;
+    }
+    timestampMs = capture.get(cv::CAP_PROP_POS_MSEC);
+    if (timestampMs <= 0.0 && framesRead > 0) {
+        timestampMs = static_cast<double>(framesRead) * frameIntervalMs;
+    }
+    framesRead++;
+    return true;
+}
+
+/// @brief Release the decoder
+void VideoFileSource::close() {
+    if (capture.isOpened()) {
+        capture.release();
+    }
+}
+
+/// @brief Video files are recordings
+bool VideoFileSource::isLive() const {
+    return false;
+}
+
+/// @brief Describes the source by its path
+std::string VideoFileSource::description() const {
+    return "video " + path;
+}
+
+/// @brief Constructor stores the directory and the rate the images were recorded at
+/**
+ * @param directory Directory holding the frames. Files that are not images are skipped.
+ * @param framesPerSecond Rate used to derive each frame's timestamp from its position in the sequence.
+ */
+ImageSequenceSource::ImageSequenceSource(std::string directory, double framesPerSecond)
+    : directory(std::move(directory)),
+      framesPerSecond(framesPerSecond > 0.0 ? framesPerSecond : 30.0) {
+}
+
+/// @brief List the directory's image files in name order
+/**
+ * Sorting by name makes the replay order independent of the filesystem, so two runs see the same sequence.
+ */
+bool ImageSequenceSource::open() {
+    files.clear();
+    nextIndex = 0;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp") {
+            files.push_back(entry.path().string());
+        }
+    }
+    if (error || files.empty()) {
+        std::cerr << "Error: No images found in " << directory << std::endl;
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+    return true;
+}
+
+/// @brief Load the next image, skipping any that cannot be decoded
+bool ImageSequenceSource::read(cv::Mat& frame, double& timestampMs) {
+    while (nextIndex < files.size()) {
+        std::size_t index = nextIndex++;
+        frame = cv::imread(files[index]);
+        if (frame.empty()) {
+            std::cerr << "Warning: Could not read image " << files[index] << std::endl;
+            continue;
+        }
+        timestampMs = static_cast<double>(index) * 1000.0 / framesPerSecond;
+        return true;
+    }
+    return false;
+}
+
+/// @brief Forget the file list
+void ImageSequenceSource::close() {
+    files.clear();
+    nextIndex = 0;
+}
+
+/// @brief Image sequences are recordings
+bool ImageSequenceSource::isLive() const {
+    return false;
+}
+
+/// @brief Describes the source by its directory
+std::string ImageSequenceSource::description() const {
+    return "images " + directory;
+}
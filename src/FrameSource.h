@@ -0,0 +1,120 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/// @brief How a recorded source is played back by the frame grabber
+enum class ReplayMode {
+    AsFastAsPossible,  ///< Every frame is delivered as soon as the consumer can take it; nothing is dropped
+    Realtime           ///< Frames are delivered at their original timestamps and dropped if the consumer lags
+};
+
+
+/// @brief Something frames can be read from: a live camera, a video file or a directory of images.
+/**
+ * The frame grabber reads from a FrameSource instead of a cv::VideoCapture directly, so the GUI, the headless
+ * daemon and the benchmarks can run on recorded input as well as on a camera. Recorded sources report each
+ * frame's original timestamp so replays can be paced exactly like the recording.
+ *
+ * @file FrameSource.h
+ */
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    /// @brief Open the source
+    /**
+     * @return true if frames can be read, false otherwise.
+     */
+    virtual bool open() = 0;
+
+    /// @brief Read the next frame
+    /**
+     * @param frame Receives the BGR frame. A new buffer is allocated for every frame.
+     * @param timestampMs Receives the frame's time in milliseconds since the start of the recording.
+     * @return true if a frame was read, false at the end of a recording or on a camera error.
+     */
+    virtual bool read(cv::Mat& frame, double& timestampMs) = 0;
+
+    /// @brief Release the source
+    virtual void close() = 0;
+
+    /// @brief Whether frames come from a live device rather than a recording
+    virtual bool isLive() const = 0;
+
+    /// @brief Human-readable description, used in log messages
+    virtual std::string description() const = 0;
+
+    /// @brief Create a source from a textual specification
+    /**
+     * @param spec A camera index ("0"), a path to a video file, or a path to a directory of images.
+     * @return The matching source, not yet opened.
+     */
+    static std::unique_ptr<FrameSource> create(const std::string& spec);
+};
+
+
+/// @brief Live camera opened through cv::VideoCapture
+class CameraSource : public FrameSource {
+public:
+    /// @brief Constructor stores the camera index to open
+    explicit CameraSource(int deviceIndex);
+
+    bool open() override;
+    bool read(cv::Mat& frame, double& timestampMs) override;
+    void close() override;
+    bool isLive() const override;
+    std::string description() const override;
+
+private:
+    int deviceIndex;
+    cv::VideoCapture capture;
+    double startTick = 0.0;
+};
+
+
+/// @brief Recorded video file decoded through cv::VideoCapture
+class VideoFileSource : public FrameSource {
+public:
+    /// @brief Constructor stores the path of the video to open
+    explicit VideoFileSource(std::string path);
+
+    bool open() override;
+    bool read(cv::Mat& frame, double& timestampMs) override;
+    void close() override;
+    bool isLive() const override;
+    std::string description() const override;
+
+private:
+    std::string path;
+    cv::VideoCapture capture;
+    double frameIntervalMs = 1000.0 / 30.0;
+    long framesRead = 0;
+};
+
+
+/// @brief Directory of still images replayed in file-name order as a fixed-rate sequence
+class ImageSequenceSource : public FrameSource {
+public:
+    /// @brief Constructor stores the directory and the rate the images were recorded at
+    /**
+     * @param directory Directory holding the frames. Files that are not images are skipped.
+     * @param framesPerSecond Rate used to derive each frame's timestamp from its position in the sequence.
+     */
+    explicit ImageSequenceSource(std::string directory, double framesPerSecond = 30.0);
+
+    bool open() override;
+    bool read(cv::Mat& frame, double& timestampMs) override;
+    void close() override;
+    bool isLive() const override;
+    std::string description() const override;
+
+private:
+    std::string directory;
+    double framesPerSecond;
+    std::vector<std::string> files;
+    std::size_t nextIndex = 0;
+};
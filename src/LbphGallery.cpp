@@ -0,0 +1,929 @@
+#include "LbphGallery.h"
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <system_error>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LBPH_GALLERY_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LBPH_GALLERY_TARGET(isa) __attribute__((target(isa)))
+#else
+#define LBPH_GALLERY_TARGET(isa)
+#endif
+
+/**
+ * @brief Nearest-neighbor LBPH matching over all enrolled histograms held in one contiguous buffer.
+ * @file LbphGallery.cpp
+ */
+
+namespace {
+
+/// Rows are padded to a multiple of this many bytes, so every row of the gallery starts on a 64-byte boundary
+const int kRowAlignmentBytes = 64;
+
+/// Identifies a gallery file
+const char kGalleryMagic[8] = {'L', 'B', 'P', 'H', 'G', 'A', 'L', '\0'};
+
+/// Layout version of gallery files, to be increased whenever GalleryFileHeader or the data after it changes
+/// (version 2: the threshold of a compact gallery is calibrated to its own distances; version 3: nextLabel)
+const std::uint32_t kGalleryVersion = 3;
+
+/// Stored in native byte order, so a file written on a host with the other byte order is recognized
+const std::uint32_t kByteOrderMark = 0x01020304;
+
+/**
+ * @brief Start of a gallery file
+ *
+ * The labels follow the header as 32-bit integers. The histogram rows follow at histogramsOffset, a multiple of
+ * 64 bytes, exactly as they are laid out in memory, so the mapped rows are as aligned as the rows of a built
+ * gallery.
+ */
+struct GalleryFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::int32_t radius;
+    std::int32_t neighbors;
+    std::int32_t gridX;
+    std::int32_t gridY;
+    double threshold;
+    std::int32_t uniform;
+    std::int32_t bits;
+    std::int32_t rows;
+    std::int32_t stride;
+    std::int32_t nextLabel;
+    std::int32_t reserved;
+    std::uint64_t labelsOffset;
+    std::uint64_t histogramsOffset;
+};
+
+/// Gallery rows compared with all queries of a batch per work item; 64 rows of 16-bit uniform bins fit in L2
+const int kBatchBlockRows = 64;
+
+/// Pairs of enrolled histograms compared to calibrate the threshold of a compact gallery
+const int kCalibrationPairs = 512;
+
+/// Flush a written file to disk, so a rename over the old file never publishes data that is not there yet
+bool syncFile(const std::string& path) {
+#ifdef _WIN32
+    int file = _open(path.c_str(), _O_WRONLY | _O_BINARY);
+    if (file < 0) {
+        return false;
+    }
+    bool synced = _commit(file) == 0;
+    _close(file);
+#else
+    int file = ::open(path.c_str(), O_WRONLY);
+    if (file < 0) {
+        return false;
+    }
+    bool synced = ::fsync(file) == 0;
+    ::close(file);
+#endif
+    return synced;
+}
+
+/// Rename a new file over an old one, then make the rename itself durable
+/**
+ * Windows refuses to replace a file that a process still maps, as a running recognizer maps the current gallery.
+ * MappedFile opens with FILE_SHARE_DELETE, which allows moving the mapped file aside, so the old file is renamed
+ * to path.old first and deleted once nothing maps it any more, at the latest by the next replacement. On POSIX the
+ * mappings keep the old file alive by themselves, and the directory is synced so the rename survives a power loss.
+ */
+bool replaceFile(const std::string& temporary, const std::string& path, std::error_code& error) {
+#ifdef _WIN32
+    std::string aside = path + ".old";
+    std::error_code ignored;
+    std::filesystem::remove(aside, ignored);
+    if (std::filesystem::exists(path, ignored)) {
+        std::filesystem::rename(path, aside, error);
+        if (error) {
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::rename(aside, path, ignored);
+        return false;
+    }
+    std::filesystem::remove(aside, ignored);
+#else
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        return false;
+    }
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    int directory = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY);
+    if (directory >= 0) {
+        ::fsync(directory);
+        ::close(directory);
+    }
+#endif
+    return true;
+}
+
+/// Round a file offset up to the row alignment
+std::uint64_t alignedOffset(std::uint64_t offset) {
+    return (offset + kRowAlignmentBytes - 1) / kRowAlignmentBytes * kRowAlignmentBytes;
+}
+
+/**
+ * @brief HISTCMP_CHISQR_ALT without the final factor of 2, as compareHist computes it
+ *
+ * Each bin contributes (a - b)^2 / (a + b), accumulated in double; bins where a + b is not above DBL_EPSILON are
+ * skipped. The vector kernels below compute the same terms four or two at a time.
+ */
+double chiSquareScalar(const float* a, const float* b, int n) {
+    double result = 0.0;
+    for (int i = 0; i < n; i++) {
+        double difference = static_cast<double>(a[i]) - b[i];
+        double sum = static_cast<double>(a[i]) + b[i];
+        if (std::fabs(sum) > DBL_EPSILON) {
+            result += difference * difference / sum;
+        }
+    }
+    return result;
+}
+
+/// The same sum over quantized bins; empty bins are the only ones skipped
+template <typename T>
+double chiSquareScalarQuantized(const T* a, const T* b, int n) {
+    double result = 0.0;
+    for (int i = 0; i < n; i++) {
+        double difference = static_cast<double>(a[i]) - b[i];
+        double sum = static_cast<double>(a[i]) + b[i];
+        if (sum > 0.0) {
+            result += difference * difference / sum;
+        }
+    }
+    return result;
+}
+
+#ifdef LBPH_GALLERY_X86
+
+/// Chi-square terms of four bins, zero where a + b is not above DBL_EPSILON
+LBPH_GALLERY_TARGET("avx2")
+inline __m256d chiSquareTermsAvx2(const float* a, const float* b) {
+    const __m256d epsilon = _mm256_set1_pd(DBL_EPSILON);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    __m256d va = _mm256_cvtps_pd(_mm_loadu_ps(a));
+    __m256d vb = _mm256_cvtps_pd(_mm_loadu_ps(b));
+    __m256d difference = _mm256_sub_pd(va, vb);
+    __m256d sum = _mm256_add_pd(va, vb);
+    __m256d valid = _mm256_cmp_pd(_mm256_andnot_pd(signMask, sum), epsilon, _CMP_GT_OQ);
+    __m256d quotient = _mm256_div_pd(_mm256_mul_pd(difference, difference), _mm256_blendv_pd(one, sum, valid));
+    return _mm256_and_pd(quotient, valid);
+}
+
+/// Four bins per step in double precision, two independent accumulators to hide the division latency
+LBPH_GALLERY_TARGET("avx2")
+double chiSquareAvx2(const float* a, const float* b, int n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, chiSquareTermsAvx2(a + i, b + i));
+        acc1 = _mm256_add_pd(acc1, chiSquareTermsAvx2(a + i + 4, b + i + 4));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm256_add_pd(acc0, chiSquareTermsAvx2(a + i, b + i));
+    }
+    __m256d acc = _mm256_add_pd(acc0, acc1);
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    double result = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    return result + chiSquareScalar(a + i, b + i, n - i);
+}
+
+/// Chi-square terms of two bins, zero where a + b is not above DBL_EPSILON
+LBPH_GALLERY_TARGET("sse2")
+inline __m128d chiSquareTermsSse2(__m128d a, __m128d b) {
+    const __m128d epsilon = _mm_set1_pd(DBL_EPSILON);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    __m128d difference = _mm_sub_pd(a, b);
+    __m128d sum = _mm_add_pd(a, b);
+    __m128d valid = _mm_cmpgt_pd(_mm_andnot_pd(signMask, sum), epsilon);
+    __m128d denominator = _mm_or_pd(_mm_and_pd(valid, sum), _mm_andnot_pd(valid, one));
+    return _mm_and_pd(_mm_div_pd(_mm_mul_pd(difference, difference), denominator), valid);
+}
+
+/// Two bins per step in double precision; SSE2 is available on every x86-64 CPU
+LBPH_GALLERY_TARGET("sse2")
+double chiSquareSse2(const float* a, const float* b, int n) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 fa = _mm_loadu_ps(a + i);
+        __m128 fb = _mm_loadu_ps(b + i);
+        acc0 = _mm_add_pd(acc0, chiSquareTermsSse2(_mm_cvtps_pd(fa), _mm_cvtps_pd(fb)));
+        acc1 = _mm_add_pd(acc1, chiSquareTermsSse2(_mm_cvtps_pd(_mm_movehl_ps(fa, fa)),
+                                                   _mm_cvtps_pd(_mm_movehl_ps(fb, fb))));
+    }
+    __m128d acc = _mm_add_pd(acc0, acc1);
+    double result = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+    return result + chiSquareScalar(a + i, b + i, n - i);
+}
+
+/// Chi-square terms of eight quantized bins in single precision, zero where both bins are empty
+LBPH_GALLERY_TARGET("avx2")
+inline __m256 chiSquareTermsQuantizedAvx2(__m256i a, __m256i b) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 va = _mm256_cvtepi32_ps(a);
+    __m256 vb = _mm256_cvtepi32_ps(b);
+    __m256 difference = _mm256_sub_ps(va, vb);
+    __m256 sum = _mm256_add_ps(va, vb);
+    __m256 valid = _mm256_cmp_ps(sum, _mm256_setzero_ps(), _CMP_GT_OQ);
+    __m256 quotient = _mm256_div_ps(_mm256_mul_ps(difference, difference), _mm256_blendv_ps(one, sum, valid));
+    return _mm256_and_ps(quotient, valid);
+}
+
+/// Add eight single-precision terms to a double-precision accumulator
+LBPH_GALLERY_TARGET("avx2")
+inline __m256d accumulateAvx2(__m256d acc, __m256 terms) {
+    acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm256_castps256_ps128(terms)));
+    return _mm256_add_pd(acc, _mm256_cvtps_pd(_mm256_extractf128_ps(terms, 1)));
+}
+
+/// Sum of the four lanes of an accumulator
+LBPH_GALLERY_TARGET("avx2")
+inline double horizontalSumAvx2(__m256d acc) {
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+/// Eight 16-bit bins per step, widened to 32-bit integers and compared in single precision
+LBPH_GALLERY_TARGET("avx2")
+double chiSquareU16Avx2(const std::uint16_t* a, const std::uint16_t* b, int n) {
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i va = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        acc = accumulateAvx2(acc, chiSquareTermsQuantizedAvx2(va, vb));
+    }
+    return horizontalSumAvx2(acc) + chiSquareScalarQuantized(a + i, b + i, n - i);
+}
+
+/// Eight 8-bit bins per step, widened to 32-bit integers and compared in single precision
+LBPH_GALLERY_TARGET("avx2")
+double chiSquareU8Avx2(const std::uint8_t* a, const std::uint8_t* b, int n) {
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i va = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + i)));
+        acc = accumulateAvx2(acc, chiSquareTermsQuantizedAvx2(va, vb));
+    }
+    return horizontalSumAvx2(acc) + chiSquareScalarQuantized(a + i, b + i, n - i);
+}
+
+#endif
+
+/// The chi-square kernels for each bin type, chosen for the CPU running the program
+struct Kernels {
+    std::string name = "scalar";
+    double (*f32)(const float*, const float*, int) = chiSquareScalar;
+    double (*u16)(const std::uint16_t*, const std::uint16_t*, int) = chiSquareScalarQuantized<std::uint16_t>;
+    double (*u8)(const std::uint8_t*, const std::uint8_t*, int) = chiSquareScalarQuantized<std::uint8_t>;
+};
+
+/// Pick the widest kernels the CPU supports; quantized bins have no SSE2 kernel and use the scalar one there
+Kernels selectKernels() {
+    Kernels selected;
+#ifdef LBPH_GALLERY_X86
+    if (cv::checkHardwareSupport(CV_CPU_AVX2)) {
+        selected.name = "avx2";
+        selected.f32 = chiSquareAvx2;
+        selected.u16 = chiSquareU16Avx2;
+        selected.u8 = chiSquareU8Avx2;
+    } else if (cv::checkHardwareSupport(CV_CPU_SSE2)) {
+        selected.name = "sse2";
+        selected.f32 = chiSquareSse2;
+    }
+#endif
+    return selected;
+}
+
+const Kernels& kernels() {
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+/// OpenCV matrix type of a bin width
+int binType(int bits) {
+    return bits == 8 ? CV_8U : bits == 16 ? CV_16U : CV_32F;
+}
+
+/**
+ * @brief Map every LBP code to a bin
+ *
+ * @param neighbors Number of bits of a code.
+ * @param uniform Whether to fold non-uniform codes into one bin.
+ * @param cellBins Receives the number of bins per cell.
+ * @return The bin of each code. Uniform codes keep their order and the last bin collects the rest.
+ */
+std::vector<int> codeBins(int neighbors, bool uniform, int& cellBins) {
+    int patterns = 1 << neighbors;
+    std::vector<int> bins(patterns);
+    if (!uniform) {
+        for (int code = 0; code < patterns; code++) {
+            bins[code] = code;
+        }
+        cellBins = patterns;
+        return bins;
+    }
+    int next = 0;
+    for (int code = 0; code < patterns; code++) {
+        int rotated = ((code << 1) | (code >> (neighbors - 1))) & (patterns - 1);
+        bins[code] = std::bitset<32>(code ^ rotated).count() <= 2 ? next++ : -1;
+    }
+    for (auto& bin : bins) {
+        if (bin < 0) {
+            bin = next;
+        }
+    }
+    cellBins = next + 1;
+    return bins;
+}
+
+}
+
+/// @brief Buffers reused by the predictions of one thread, so a prediction allocates nothing once they have grown
+struct LbphGallery::Scratch {
+    cv::Mat codes;                      ///< LBP code of every pixel
+    cv::Mat full;                       ///< Histogram with all 2^neighbors codes per cell
+    cv::Mat folded;                     ///< Histogram in the gallery's bins, before quantization
+    cv::Mat query;                      ///< Histogram in the gallery's format
+    cv::Mat batch;                      ///< Query histograms of a batch, one row per face
+    std::vector<int> blockLabels;       ///< Best label per gallery block and query of a batch
+    std::vector<double> blockDistances; ///< Best distance per gallery block and query of a batch
+};
+
+/// @brief The calling thread's buffers; worker threads of cv::parallel_for_ each get their own
+LbphGallery::Scratch& LbphGallery::threadScratch() {
+    thread_local Scratch scratch;
+    return scratch;
+}
+
+/// @brief Copy the parameters and histograms of a trained recognizer
+/**
+ * @param model The recognizer after read() or train().
+ * @param format How to store the histograms; the default keeps them exactly as OpenCV computes them.
+ * @return true if the model holds at least one histogram, false otherwise.
+ */
+bool LbphGallery::build(const cv::face::LBPHFaceRecognizer& model, const GalleryFormat& format) {
+    radius = model.getRadius();
+    neighbors = model.getNeighbors();
+    gridX = model.getGridX();
+    gridY = model.getGridY();
+    threshold = model.getThreshold();
+    setLayout(format);
+    // Detach from a mapped file first, create() would otherwise reuse its read-only pages
+    rows.release();
+    mapping.reset();
+
+    std::vector<cv::Mat> histograms = model.getHistograms();
+    cv::Mat modelLabels = model.getLabels();
+    cv::Mat folded;
+    int fullBins = gridX * gridY * (1 << neighbors);
+    labels.clear();
+    rows.create(static_cast<int>(histograms.size()), stride, binType(storage.bits));
+    for (std::size_t i = 0; i < histograms.size(); i++) {
+        const cv::Mat& histogram = histograms[i];
+        if (static_cast<int>(histogram.total()) != fullBins || histogram.type() != CV_32F) {
+            std::cerr << "Error: Histogram " << i << " of the model does not match its parameters" << std::endl;
+            rows.release();
+            labels.clear();
+            return false;
+        }
+        cv::Mat row = rows.row(static_cast<int>(i));
+        compact(histogram.reshape(1, 1), folded, row);
+        labels.push_back(modelLabels.at<int>(static_cast<int>(i)));
+    }
+    labelLimit = labels.empty() ? 0 : *std::max_element(labels.begin(), labels.end()) + 1;
+    threshold = calibratedThreshold(threshold, histograms);
+    return !labels.empty();
+}
+
+/// @brief The model's threshold in the units of this gallery's distances
+/**
+ * @param modelThreshold Threshold of the OpenCV model, on full-histogram distances.
+ * @param histograms The model's histograms, in the order of the gallery's rows.
+ * @return The threshold unchanged for the exact format, or scaled for a compact one.
+ *
+ * Folding bins lowers chi-square distances and quantizing shifts them a little, so the model's threshold applied
+ * unchanged to a compact gallery would accept faces the model rejects. Each enrolled image is compared with the
+ * next one, most often the same person, and with the one half the gallery away, most often someone else; the
+ * threshold is scaled by the median ratio of the compact to the full distance over these pairs.
+ */
+double LbphGallery::calibratedThreshold(double modelThreshold, const std::vector<cv::Mat>& histograms) const {
+    int count = static_cast<int>(histograms.size());
+    if ((!storage.uniform && storage.bits == 32) || modelThreshold >= DBL_MAX || count < 2) {
+        return modelThreshold;
+    }
+    std::vector<double> ratios;
+    int step = std::max(1, 2 * count / kCalibrationPairs);
+    for (int i = 0; i < count; i += step) {
+        for (int j : {(i + 1) % count, (i + count / 2) % count}) {
+            if (j == i) {
+                continue;
+            }
+            double full = cv::compareHist(histograms[i], histograms[j], cv::HISTCMP_CHISQR_ALT);
+            if (full > 0.0) {
+                ratios.push_back(chiSquare(rows.ptr(i), rows.ptr(j)) / full);
+            }
+        }
+    }
+    if (ratios.empty()) {
+        return modelThreshold;
+    }
+    auto median = ratios.begin() + ratios.size() / 2;
+    std::nth_element(ratios.begin(), median, ratios.end());
+    return modelThreshold * *median;
+}
+
+/// @brief Find the enrolled image closest to a face
+/**
+ * @param face Grayscale face crop.
+ * @param distance Receives the chi-square distance to the closest image, or DBL_MAX if none is below the threshold.
+ * @return The label of the closest image, or -1 if no image is closer than the threshold.
+ *
+ * Same selection rule as LBPHFaceRecognizer::predict: the first image with the smallest distance wins, and only
+ * distances below the threshold count.
+ */
+int LbphGallery::predict(const cv::Mat& face, double& distance) const {
+    int label = -1;
+    distance = DBL_MAX;
+    if (labels.empty()) {
+        return label;
+    }
+    Scratch& scratch = threadScratch();
+    computeHistogram(face, scratch);
+    const uchar* query = scratch.query.ptr();
+    for (int i = 0; i < rows.rows; i++) {
+        double candidate = chiSquare(rows.ptr(i), query);
+        if (candidate < distance && candidate < threshold) {
+            distance = candidate;
+            label = labels[i];
+        }
+    }
+    return label;
+}
+
+/// @brief Find the closest enrolled image for every face of a frame in one pass over the gallery
+/**
+ * @param faces Grayscale face crops.
+ * @param predicted Receives one label per face, as predict() returns it.
+ * @param distances Receives one distance per face, as predict() sets it.
+ *
+ * The query histograms are computed in parallel into one buffer. The gallery is then split into blocks of rows that
+ * are scanned in parallel, and each row is compared with every query while it is in cache, so the gallery is read
+ * from memory once per frame instead of once per face. The blocks are merged in order with the same rule as
+ * predict(), so every face gets exactly the result predict() would give it.
+ */
+void LbphGallery::predictBatch(const std::vector<cv::Mat>& faces, std::vector<int>& predicted,
+                               std::vector<double>& distances) const {
+    int queryCount = static_cast<int>(faces.size());
+    predicted.assign(queryCount, -1);
+    distances.assign(queryCount, DBL_MAX);
+    if (labels.empty() || queryCount == 0) {
+        return;
+    }
+
+    Scratch& scratch = threadScratch();
+    cv::Mat& queries = scratch.batch;
+    queries.create(queryCount, stride, binType(storage.bits));
+    cv::parallel_for_(cv::Range(0, queryCount), [&](const cv::Range& range) {
+        Scratch& worker = threadScratch();
+        for (int q = range.start; q < range.end; q++) {
+            computeHistogram(faces[q], worker);
+            cv::Mat query = queries.row(q);
+            worker.query.copyTo(query);
+        }
+    });
+
+    int blockCount = (rows.rows + kBatchBlockRows - 1) / kBatchBlockRows;
+    std::vector<int>& blockLabels = scratch.blockLabels;
+    std::vector<double>& blockDistances = scratch.blockDistances;
+    blockLabels.assign(static_cast<std::size_t>(blockCount) * queryCount, -1);
+    blockDistances.assign(blockLabels.size(), DBL_MAX);
+    cv::parallel_for_(cv::Range(0, blockCount), [&](const cv::Range& range) {
+        for (int block = range.start; block < range.end; block++) {
+            int* bestLabel = &blockLabels[static_cast<std::size_t>(block) * queryCount];
+            double* bestDistance = &blockDistances[static_cast<std::size_t>(block) * queryCount];
+            int end = std::min(rows.rows, (block + 1) * kBatchBlockRows);
+            for (int i = block * kBatchBlockRows; i < end; i++) {
+                const uchar* enrolled = rows.ptr(i);
+                for (int q = 0; q < queryCount; q++) {
+                    double candidate = chiSquare(enrolled, queries.ptr(q));
+                    if (candidate < bestDistance[q] && candidate < threshold) {
+                        bestDistance[q] = candidate;
+                        bestLabel[q] = labels[i];
+                    }
+                }
+            }
+        }
+    });
+
+    // A later block only wins with a strictly smaller distance, as a later row does in predict()
+    for (int block = 0; block < blockCount; block++) {
+        for (int q = 0; q < queryCount; q++) {
+            std::size_t index = static_cast<std::size_t>(block) * queryCount + q;
+            if (blockDistances[index] < distances[q]) {
+                distances[q] = blockDistances[index];
+                predicted[q] = blockLabels[index];
+            }
+        }
+    }
+}
+
+/// @brief Compute the spatial LBP histogram of a face, as one padded row in the gallery's format
+/**
+ * A port of OpenCV's extended LBP operator and spatial histogram for 8-bit images: each pixel is compared with
+ * `neighbors` bilinearly interpolated points on a circle of `radius`, the resulting codes are counted in a
+ * gridX x gridY grid of cells, and every cell's counts are divided by its pixel count. The result is then brought
+ * into the gallery's format by compact().
+ */
+cv::Mat LbphGallery::histogram(const cv::Mat& face) const {
+    Scratch scratch;
+    computeHistogram(face, scratch);
+    return scratch.query;
+}
+
+/// @brief Compute the histogram of a face into scratch.query, reusing the buffers of scratch
+void LbphGallery::computeHistogram(const cv::Mat& face, Scratch& scratch) const {
+    cv::Mat& result = scratch.full;
+    result.create(1, gridX * gridY * (1 << neighbors), CV_32F);
+    result.setTo(cv::Scalar(0));
+    cv::Mat src = face;
+    if (src.type() != CV_8UC1) {
+        face.convertTo(src, CV_8U);
+    }
+    int codeRows = src.rows - 2 * radius;
+    int codeCols = src.cols - 2 * radius;
+    if (codeRows <= 0 || codeCols <= 0) {
+        compact(result, scratch.folded, scratch.query);
+        return;
+    }
+
+    cv::Mat& codes = scratch.codes;
+    codes.create(codeRows, codeCols, CV_32S);
+    codes.setTo(cv::Scalar(0));
+    for (int n = 0; n < neighbors; n++) {
+        float x = static_cast<float>(radius * std::cos(2.0 * CV_PI * n / static_cast<float>(neighbors)));
+        float y = static_cast<float>(-radius * std::sin(2.0 * CV_PI * n / static_cast<float>(neighbors)));
+        int fx = static_cast<int>(std::floor(x));
+        int fy = static_cast<int>(std::floor(y));
+        int cx = static_cast<int>(std::ceil(x));
+        int cy = static_cast<int>(std::ceil(y));
+        float ty = y - fy;
+        float tx = x - fx;
+        float w1 = (1 - tx) * (1 - ty);
+        float w2 = tx * (1 - ty);
+        float w3 = (1 - tx) * ty;
+        float w4 = tx * ty;
+        for (int i = radius; i < src.rows - radius; i++) {
+            const uchar* center = src.ptr<uchar>(i);
+            const uchar* top = src.ptr<uchar>(i + fy);
+            const uchar* bottom = src.ptr<uchar>(i + cy);
+            int* code = codes.ptr<int>(i - radius);
+            for (int j = radius; j < src.cols - radius; j++) {
+                float t = static_cast<float>(w1 * top[j + fx] + w2 * top[j + cx] + w3 * bottom[j + fx] +
+                                             w4 * bottom[j + cx]);
+                code[j - radius] += ((t > center[j]) ||
+                                     (std::abs(t - center[j]) < std::numeric_limits<float>::epsilon())) << n;
+            }
+        }
+    }
+
+    int patterns = 1 << neighbors;
+    int cellWidth = codeCols / gridX;
+    int cellHeight = codeRows / gridY;
+    if (cellWidth == 0 || cellHeight == 0) {
+        compact(result, scratch.folded, scratch.query);
+        return;
+    }
+    float scale = static_cast<float>(1.0 / (cellWidth * cellHeight));
+    float* cell = result.ptr<float>();
+    for (int i = 0; i < gridY; i++) {
+        for (int j = 0; j < gridX; j++, cell += patterns) {
+            for (int r = i * cellHeight; r < (i + 1) * cellHeight; r++) {
+                const int* code = codes.ptr<int>(r);
+                for (int c = j * cellWidth; c < (j + 1) * cellWidth; c++) {
+                    cell[code[c]] += 1.0f;
+                }
+            }
+            for (int b = 0; b < patterns; b++) {
+                cell[b] *= scale;
+            }
+        }
+    }
+    compact(result, scratch.folded, scratch.query);
+}
+
+/// @brief Chi-square distance between an enrolled image and a histogram from histogram()
+/**
+ * @param row Index of the enrolled image.
+ * @param query Histogram in the gallery's format.
+ * @return HISTCMP_CHISQR_ALT of the two histograms in normalized units, computed with the kernel selected for this
+ *         CPU. The zero padding at the end of the rows contributes nothing.
+ */
+double LbphGallery::compare(int row, const cv::Mat& query) const {
+    return chiSquare(rows.ptr(row), query.ptr());
+}
+
+/// @brief Chi-square distance between two rows in the gallery's format, with the kernel selected for this CPU
+double LbphGallery::chiSquare(const uchar* enrolled, const uchar* query) const {
+    const Kernels& selected = kernels();
+    double sum = 0.0;
+    if (storage.bits == 8) {
+        sum = selected.u8(enrolled, query, stride);
+    } else if (storage.bits == 16) {
+        sum = selected.u16(reinterpret_cast<const std::uint16_t*>(enrolled),
+                           reinterpret_cast<const std::uint16_t*>(query), stride);
+    } else {
+        sum = selected.f32(reinterpret_cast<const float*>(enrolled), reinterpret_cast<const float*>(query), stride);
+    }
+    // Chi-square scales linearly with its inputs, so dividing by the quantization factor restores normalized units
+    return 2.0 * sum / quantization;
+}
+
+/// @brief Save the gallery as a binary file
+/**
+ * @param path Destination file, e.g. recognizer/gallery.bin.
+ * @return true if the file was written, false otherwise.
+ *
+ * The file is written next to the destination, synced to disk and renamed over it, so a process mapping the old
+ * file keeps a consistent gallery and no reader ever sees a partial file, not even after a power loss.
+ */
+bool LbphGallery::write(const std::string& path) const {
+    GalleryFileHeader header = {};
+    std::memcpy(header.magic, kGalleryMagic, sizeof(header.magic));
+    header.version = kGalleryVersion;
+    header.byteOrder = kByteOrderMark;
+    header.radius = radius;
+    header.neighbors = neighbors;
+    header.gridX = gridX;
+    header.gridY = gridY;
+    header.threshold = threshold;
+    header.uniform = storage.uniform ? 1 : 0;
+    header.bits = storage.bits;
+    header.rows = rows.rows;
+    header.stride = stride;
+    header.nextLabel = labelLimit;
+    header.labelsOffset = sizeof(GalleryFileHeader);
+    header.histogramsOffset = alignedOffset(header.labelsOffset + labels.size() * sizeof(std::int32_t));
+
+    std::string temporary = path + ".tmp";
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open " << temporary << " for writing." << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (int label : labels) {
+        std::int32_t value = label;
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    std::vector<char> padding(header.histogramsOffset - header.labelsOffset - labels.size() * sizeof(std::int32_t), 0);
+    file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    for (int i = 0; i < rows.rows; i++) {
+        file.write(reinterpret_cast<const char*>(rows.ptr(i)), static_cast<std::streamsize>(stride * rows.elemSize()));
+    }
+    file.close();
+    if (!file || !syncFile(temporary)) {
+        std::cerr << "Error: Writing " << temporary << " failed." << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    if (!replaceFile(temporary, path, error)) {
+        std::cerr << "Error: Unable to replace " << path << ": " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// @brief Map a gallery saved by write()
+/**
+ * @param path File written by write().
+ * @return true if the gallery was mapped, false if the file is missing, of another version or inconsistent.
+ *         The gallery is unchanged on failure.
+ *
+ * Only the header is checked and the labels are copied; the histogram rows are used in place in the mapping.
+ */
+bool LbphGallery::read(const std::string& path) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(path)) {
+        return false;
+    }
+    GalleryFileHeader header;
+    if (file->size() < sizeof(header)) {
+        std::cerr << "Error: " << path << " is not a gallery file" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, kGalleryMagic, sizeof(header.magic)) != 0 || header.byteOrder != kByteOrderMark) {
+        std::cerr << "Error: " << path << " is not a gallery file for this platform" << std::endl;
+        return false;
+    }
+    if (header.version != kGalleryVersion) {
+        std::cerr << "Error: " << path << " has gallery version " << header.version << ", expected "
+                  << kGalleryVersion << ". Retrain or convert the model again." << std::endl;
+        return false;
+    }
+
+    LbphGallery loaded;
+    loaded.radius = header.radius;
+    loaded.neighbors = header.neighbors;
+    loaded.gridX = header.gridX;
+    loaded.gridY = header.gridY;
+    loaded.threshold = header.threshold;
+    if (header.neighbors < 1 || header.neighbors > 16 || header.gridX < 1 || header.gridY < 1 || header.rows < 0) {
+        std::cerr << "Error: Gallery " << path << " is inconsistent" << std::endl;
+        return false;
+    }
+    loaded.setLayout(GalleryFormat{header.uniform != 0, header.bits});
+
+    std::size_t elementSize = loaded.storage.bits / 8;
+    std::uint64_t labelsEnd = header.labelsOffset + static_cast<std::uint64_t>(header.rows) * sizeof(std::int32_t);
+    std::uint64_t histogramsEnd = header.histogramsOffset +
+                                  static_cast<std::uint64_t>(header.rows) * loaded.stride * elementSize;
+    if (header.stride != loaded.stride || header.bits != loaded.storage.bits || labelsEnd > header.histogramsOffset ||
+        header.histogramsOffset % kRowAlignmentBytes != 0 || histogramsEnd > file->size()) {
+        std::cerr << "Error: Gallery " << path << " is inconsistent" << std::endl;
+        return false;
+    }
+
+    loaded.labels.resize(header.rows);
+    std::memcpy(loaded.labels.data(), file->data() + header.labelsOffset, header.rows * sizeof(std::int32_t));
+    loaded.labelLimit = header.nextLabel;
+    for (int label : loaded.labels) {
+        loaded.labelLimit = std::max(loaded.labelLimit, label + 1);
+    }
+    // The mapping is read-only; cv::Mat only needs a non-const pointer and the gallery never writes through it
+    loaded.rows = cv::Mat(header.rows, loaded.stride, binType(loaded.storage.bits),
+                          const_cast<unsigned char*>(file->data() + header.histogramsOffset));
+    loaded.mapping = file;
+    *this = std::move(loaded);
+    return true;
+}
+
+/// @brief Enroll face crops under a label without retraining
+/**
+ * @param faces Grayscale face crops, preprocessed as for training.
+ * @param label Label of the faces, new or already enrolled.
+ * @return The number of images enrolled, or -1 if the gallery has no LBP parameters yet.
+ *
+ * Only the new faces are histogrammed. The enrolled rows are copied once into a larger buffer, which also detaches a
+ * mapped gallery from its file. The result is the gallery a full retrain would give with these images added.
+ */
+int LbphGallery::add(const std::vector<cv::Mat>& faces, int label) {
+    if (bins == 0) {
+        std::cerr << "Error: The gallery has no LBP parameters, train a model first" << std::endl;
+        return -1;
+    }
+    int enrolled = rows.empty() ? 0 : rows.rows;
+    cv::Mat grown(enrolled + static_cast<int>(faces.size()), stride, binType(storage.bits));
+    if (enrolled > 0) {
+        cv::Mat existing = grown.rowRange(0, enrolled);
+        rows.copyTo(existing);
+    }
+    Scratch& scratch = threadScratch();
+    for (std::size_t i = 0; i < faces.size(); i++) {
+        computeHistogram(faces[i], scratch);
+        cv::Mat row = grown.row(enrolled + static_cast<int>(i));
+        scratch.query.copyTo(row);
+        labels.push_back(label);
+    }
+    labelLimit = std::max(labelLimit, label + 1);
+    rows = grown;
+    mapping.reset();
+    return static_cast<int>(faces.size());
+}
+
+/// @brief Drop every image enrolled under a label, keeping the order of the others
+/**
+ * @param label Label to remove.
+ * @return The number of images removed.
+ *
+ * The remaining rows are copied into a new buffer, so a mapped gallery is detached from its file.
+ */
+int LbphGallery::removeLabel(int label) {
+    int removed = count(label);
+    if (removed == 0) {
+        return 0;
+    }
+    cv::Mat remaining(size() - removed, stride, binType(storage.bits));
+    std::vector<int> remainingLabels;
+    remainingLabels.reserve(labels.size() - removed);
+    for (std::size_t i = 0; i < labels.size(); i++) {
+        if (labels[i] == label) {
+            continue;
+        }
+        cv::Mat row = remaining.row(static_cast<int>(remainingLabels.size()));
+        rows.row(static_cast<int>(i)).copyTo(row);
+        remainingLabels.push_back(labels[i]);
+    }
+    rows = remaining;
+    labels = std::move(remainingLabels);
+    mapping.reset();
+    return removed;
+}
+
+/// @brief Number of enrolled images
+int LbphGallery::size() const {
+    return static_cast<int>(labels.size());
+}
+
+/// @brief Number of images enrolled under a label
+int LbphGallery::count(int label) const {
+    return static_cast<int>(std::count(labels.begin(), labels.end(), label));
+}
+
+/// @brief Whether the gallery holds no images
+bool LbphGallery::empty() const {
+    return labels.empty();
+}
+
+/// @brief The storage format of the histograms
+const GalleryFormat& LbphGallery::format() const {
+    return storage;
+}
+
+/// @brief Distance below which predict() accepts a match, in the units of this gallery's distances
+double LbphGallery::acceptThreshold() const {
+    return threshold;
+}
+
+/// @brief The label a new person gets: one more than the highest label ever enrolled, even if it was removed since
+int LbphGallery::nextLabel() const {
+    return labelLimit;
+}
+
+/// @brief Bytes held by the histograms and labels
+std::size_t LbphGallery::memoryBytes() const {
+    return rows.total() * rows.elemSize() + labels.size() * sizeof(int);
+}
+
+/// @brief Name of the chi-square kernel selected for this CPU: "avx2", "sse2" or "scalar"
+std::string LbphGallery::kernelName() {
+    return kernels().name;
+}
+
+/// @brief Derive the bin mapping, row length and quantization factor of a format from the LBP parameters
+void LbphGallery::setLayout(const GalleryFormat& newFormat) {
+    storage = newFormat;
+    if (storage.bits != 8 && storage.bits != 16) {
+        storage.bits = 32;
+    }
+    quantization = storage.bits == 8 ? 255.0 : storage.bits == 16 ? 65535.0 : 1.0;
+    binOfCode = codeBins(neighbors, storage.uniform, cellBins);
+    bins = gridX * gridY * cellBins;
+    int perRow = kRowAlignmentBytes / (storage.bits / 8);
+    stride = (bins + perRow - 1) / perRow * perRow;
+}
+
+/// @brief Bring a full OpenCV histogram into the gallery's format
+/**
+ * @param fullHistogram One row of gridX * gridY * 2^neighbors normalized float bins.
+ * @param folded Buffer for the folded float bins, only used when the bins are quantized.
+ * @param output Receives one row of stride elements: the bins folded by binOfCode, scaled by the quantization factor
+ *               and rounded to the storage type, then zero padded. May be a row of a larger matrix.
+ */
+void LbphGallery::compact(const cv::Mat& fullHistogram, cv::Mat& folded, cv::Mat& output) const {
+    cv::Mat& target = storage.bits == 32 ? output : folded;
+    target.create(1, stride, CV_32F);
+    target.setTo(cv::Scalar(0));
+    int patterns = 1 << neighbors;
+    const float* source = fullHistogram.ptr<float>();
+    float* bin = target.ptr<float>();
+    for (int cell = 0; cell < gridX * gridY; cell++) {
+        for (int code = 0; code < patterns; code++) {
+            bin[cell * cellBins + binOfCode[code]] += source[cell * patterns + code];
+        }
+    }
+    if (storage.bits != 32) {
+        folded.convertTo(output, binType(storage.bits), quantization);
+    }
+}
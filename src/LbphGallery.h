@@ -0,0 +1,176 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/face.hpp>
+#include <cfloat>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+
+/// @brief How an LbphGallery stores its histograms
+struct GalleryFormat {
+    bool uniform = false;   ///< Fold each cell's 2^neighbors LBP codes into uniform-pattern bins plus one other bin
+    int bits = 32;          ///< 32 stores float bins; 16 or 8 stores bins quantized to unsigned integers
+};
+
+
+/// @brief Nearest-neighbor LBPH matching over all enrolled histograms held in one contiguous buffer.
+/**
+ * OpenCV's LBPHFaceRecognizer keeps every training histogram as its own cv::Mat and compares the query with each
+ * of them through compareHist, so predict time is dominated by pointer chasing and scalar arithmetic as the number
+ * of enrolled images grows. The gallery copies the histograms of a trained recognizer into a single row-major
+ * matrix, one padded row per image, and scans it with a chi-square kernel picked at runtime for the CPU: AVX2,
+ * SSE2 or plain C++.
+ *
+ * The query histogram is computed exactly as OpenCV computes it, and the distance is the same HISTCMP_CHISQR_ALT
+ * accumulated in double precision, so predict() returns the same label and distance as the recognizer it was built
+ * from (up to rounding in the last digits).
+ *
+ * A compact GalleryFormat trades a little of that exactness for size. With 10 neighbors only 92 of the 1024 codes
+ * of a cell are uniform patterns (at most two 0/1 transitions around the circle), and they cover the large
+ * majority of pixels of a face, so folding the others into one bin shrinks each histogram elevenfold. Quantizing
+ * the bins to 16 or 8 bits halves or quarters it again. Folding bins lowers the chi-square distances, so build()
+ * scales the recognizer's threshold to the compact distances, measured on pairs of enrolled images, and write()
+ * stores the scaled threshold in the file; acceptThreshold() reports it.
+ *
+ * write() saves a gallery in a versioned binary file (recognizer/gallery.bin) laid out exactly like the gallery in
+ * memory, and read() maps that file instead of reading it: opening takes no parsing, and processes on the same
+ * host share the histograms through the page cache. A deployment does not have to load the OpenCV model at all.
+ *
+ * All const methods only read the gallery and keep their working buffers per thread, so any number of threads may
+ * predict against one gallery at once without locking, and after its first prediction a thread allocates nothing
+ * more per face. add(), removeLabel(), build() and read() modify the gallery and must not run concurrently with
+ * anything else; to change a gallery that is in use, change a copy and publish it, as FaceRecognizerWrapper does.
+ *
+ * LBPH has no model to fit, so a gallery can also be edited in place: add() histograms the new faces of one person
+ * and appends them, and removeLabel() compacts a person's rows out. Either copies a mapped gallery into memory
+ * first; write() then saves the result for the other processes.
+ *
+ * @file LbphGallery.h
+ */
+class LbphGallery {
+public:
+    /// @brief Copy the parameters and histograms of a trained recognizer
+    /**
+     * @param model The recognizer after read() or train().
+     * @return true if the model holds at least one histogram, false otherwise.
+     */
+    bool build(const cv::face::LBPHFaceRecognizer& model, const GalleryFormat& format = GalleryFormat());
+
+    /// @brief Save the gallery as a binary file
+    /**
+     * @param path Destination file, e.g. recognizer/gallery.bin.
+     * @return true if the file was written, false otherwise.
+     *
+     * The file is written next to the destination, synced to disk and renamed over it, so a process mapping the old
+     * file keeps a consistent gallery and no reader ever sees a partial file, not even after a power loss.
+     */
+    bool write(const std::string& path) const;
+
+    /// @brief Map a gallery saved by write()
+    /**
+     * @param path File written by write().
+     * @return true if the gallery was mapped, false if the file is missing, of another version or inconsistent.
+     *         The gallery is unchanged on failure.
+     */
+    bool read(const std::string& path);
+
+    /// @brief Enroll face crops under a label without retraining
+    /**
+     * @param faces Grayscale face crops, preprocessed as for training.
+     * @param label Label of the faces, new or already enrolled.
+     * @return The number of images enrolled, or -1 if the gallery has no LBP parameters yet.
+     */
+    int add(const std::vector<cv::Mat>& faces, int label);
+
+    /// @brief Drop every image enrolled under a label, keeping the order of the others
+    /**
+     * @param label Label to remove.
+     * @return The number of images removed.
+     */
+    int removeLabel(int label);
+
+    /// @brief Find the enrolled image closest to a face
+    /**
+     * @param face Grayscale face crop.
+     * @param distance Receives the chi-square distance to the closest image, or DBL_MAX if none is below the
+     *                 threshold.
+     * @return The label of the closest image, or -1 if no image is closer than the threshold.
+     */
+    int predict(const cv::Mat& face, double& distance) const;
+
+    /// @brief Find the closest enrolled image for every face of a frame in one pass over the gallery
+    /**
+     * @param faces Grayscale face crops.
+     * @param predicted Receives one label per face, as predict() returns it.
+     * @param distances Receives one distance per face, as predict() sets it.
+     */
+    void predictBatch(const std::vector<cv::Mat>& faces, std::vector<int>& predicted,
+                      std::vector<double>& distances) const;
+
+    /// @brief Compute the spatial LBP histogram of a face, as one padded row in the gallery's format
+    cv::Mat histogram(const cv::Mat& face) const;
+
+    /// @brief Chi-square distance between an enrolled image and a histogram from histogram()
+    double compare(int row, const cv::Mat& query) const;
+
+    /// @brief Number of enrolled images
+    int size() const;
+
+    /// @brief Number of images enrolled under a label
+    int count(int label) const;
+
+    /// @brief Whether the gallery holds no images
+    bool empty() const;
+
+    /// @brief The storage format of the histograms
+    const GalleryFormat& format() const;
+
+    /// @brief Distance below which predict() accepts a match, in the units of this gallery's distances
+    /**
+     * @return The model's threshold for the exact format, the calibrated one for a compact format, DBL_MAX if none.
+     */
+    double acceptThreshold() const;
+
+    /// @brief The label a new person gets: one more than the highest label ever enrolled, even if it was removed since
+    /**
+     * write() keeps it in the file, so a label freed by removeLabel() is never given to someone else, whose
+     * decisions would otherwise be matched to the profile and the cached name of the removed person.
+     */
+    int nextLabel() const;
+
+    /// @brief Bytes held by the histograms and labels
+    std::size_t memoryBytes() const;
+
+    /// @brief Name of the chi-square kernel selected for this CPU: "avx2", "sse2" or "scalar"
+    static std::string kernelName();
+
+private:
+    struct Scratch;
+    static Scratch& threadScratch();
+
+    void setLayout(const GalleryFormat& newFormat);
+    double calibratedThreshold(double modelThreshold, const std::vector<cv::Mat>& histograms) const;
+    void computeHistogram(const cv::Mat& face, Scratch& scratch) const;
+    void compact(const cv::Mat& fullHistogram, cv::Mat& folded, cv::Mat& output) const;
+    double chiSquare(const uchar* enrolled, const uchar* query) const;
+
+    int radius = 1;
+    int neighbors = 8;
+    int gridX = 8;
+    int gridY = 8;
+    double threshold = DBL_MAX;  ///< In the units of the stored histograms, see calibratedThreshold()
+    GalleryFormat storage;
+    std::vector<int> binOfCode;  ///< Bin of each LBP code within a cell
+    int cellBins = 0;            ///< Bins per cell, 2^neighbors or the uniform patterns plus one
+    int bins = 0;                ///< Histogram length, gridX * gridY * cellBins
+    int stride = 0;              ///< Row length in elements, bins rounded up to a multiple of 64 bytes
+    double quantization = 1.0;   ///< Factor from normalized bin values to stored values
+    cv::Mat rows;                ///< One histogram per enrolled image, zero padded to stride elements
+    std::vector<int> labels;     ///< Label of each row
+    int labelLimit = 0;          ///< One more than the highest label ever enrolled, see nextLabel()
+    std::shared_ptr<const MappedFile> mapping;   ///< The file rows points into after read(), shared by copies
+};
@@ -0,0 +1,106 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief A whole file mapped read-only into memory.
+ * @file MappedFile.cpp
+ */
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+/// @brief Map a file
+/**
+ * @param path File to map.
+ * @return true if the file was mapped, false if it is missing, empty or cannot be mapped.
+ */
+bool MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        std::cerr << "Error mapping " << path << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        std::cerr << "Error mapping " << path << std::endl;
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    mapped = static_cast<const unsigned char*>(view);
+    length = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        ::close(descriptor);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+    // The mapping keeps the file referenced, the descriptor is no longer needed
+    ::close(descriptor);
+    if (view == MAP_FAILED) {
+        std::cerr << "Error mapping " << path << std::endl;
+        return false;
+    }
+    mapped = static_cast<const unsigned char*>(view);
+    length = static_cast<std::size_t>(status.st_size);
+#endif
+    return true;
+}
+
+/// @brief Unmap the file; data() is null afterwards
+void MappedFile::close() {
+    if (mapped == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(mapped);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    munmap(const_cast<unsigned char*>(mapped), length);
+#endif
+    mapped = nullptr;
+    length = 0;
+}
+
+/// @brief First byte of the mapping, null if nothing is mapped
+const unsigned char* MappedFile::data() const {
+    return mapped;
+}
+
+/// @brief Length of the mapping in bytes
+std::size_t MappedFile::size() const {
+    return length;
+}
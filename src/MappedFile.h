@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+
+/// @brief A whole file mapped read-only into memory.
+/**
+ * The pages come straight from the operating system's page cache, so opening costs no parsing or copying, only the
+ * pages that are touched are read from disk, and every process mapping the same file shares one copy in memory.
+ * Replacing the file by renaming a new one over it leaves existing mappings valid; they keep seeing the old
+ * contents until they are closed.
+ *
+ * @file MappedFile.h
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// @brief Map a file
+    /**
+     * @param path File to map.
+     * @return true if the file was mapped, false if it is missing, empty or cannot be mapped.
+     */
+    bool open(const std::string& path);
+
+    /// @brief Unmap the file; data() is null afterwards
+    void close();
+
+    /// @brief First byte of the mapping, null if nothing is mapped
+    const unsigned char* data() const;
+
+    /// @brief Length of the mapping in bytes
+    std::size_t size() const;
+
+private:
+    const unsigned char* mapped = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
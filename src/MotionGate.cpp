@@ -0,0 +1,78 @@
+#include "MotionGate.h"
+#include <algorithm>
+
+/**
+ * @brief Cheap presence check that lets the pipeline idle while nothing in front of the camera changes.
+ * @file MotionGate.cpp
+ */
+
+namespace {
+
+/// Width of the thumbnail motion is measured on
+const int kThumbnailWidth = 80;
+
+/// Per-pixel intensity change that counts as motion
+const double kPixelThreshold = 20.0;
+
+/// Weight of the newest thumbnail in the running-average background
+const double kBackgroundRate = 0.05;
+
+}
+
+/// @brief Constructor sets how long the gate stays open after motion
+/**
+ * @param hangoverFrames Number of frames the gate stays open after the last frame with motion.
+ * @param minChangedFraction Fraction of thumbnail pixels that must change for a frame to count as motion.
+ */
+MotionGate::MotionGate(int hangoverFrames, double minChangedFraction)
+    : hangoverFrames(std::max(0, hangoverFrames)),
+      minChangedFraction(minChangedFraction) {
+}
+
+/// @brief Compare a frame with the background and decide whether it should be processed
+/**
+ * @param frame The BGR frame as captured.
+ * @param keepOpen Keeps the gate open regardless of motion, e.g. while faces are being tracked.
+ * @return true if the frame should go through detection and recognition.
+ *
+ * The frame is shrunk before the color conversion, so the full-resolution image is never touched here.
+ */
+bool MotionGate::update(const cv::Mat& frame, bool keepOpen) {
+    if (frame.empty()) {
+        return false;
+    }
+    double scale = std::min(1.0, static_cast<double>(kThumbnailWidth) / frame.cols);
+    cv::Mat small;
+    cv::resize(frame, small, cv::Size(), scale, scale, cv::INTER_AREA);
+    cv::cvtColor(small, thumbnail, cv::COLOR_BGR2GRAY);
+    cv::GaussianBlur(thumbnail, thumbnail, cv::Size(5, 5), 0);
+
+    bool motion = false;
+    if (background.empty() || background.size() != thumbnail.size()) {
+        thumbnail.convertTo(background, CV_32F);
+        motion = true;
+    } else {
+        cv::Mat reference;
+        background.convertTo(reference, CV_8U);
+        cv::absdiff(thumbnail, reference, difference);
+        cv::threshold(difference, difference, kPixelThreshold, 255, cv::THRESH_BINARY);
+        motion = cv::countNonZero(difference) > minChangedFraction * static_cast<double>(difference.total());
+        cv::accumulateWeighted(thumbnail, background, kBackgroundRate);
+    }
+
+    if (motion || keepOpen) {
+        framesLeftOpen = hangoverFrames;
+        return true;
+    }
+    if (framesLeftOpen > 0) {
+        framesLeftOpen--;
+        return true;
+    }
+    return false;
+}
+
+/// @brief Forget the background; the next frame rebuilds it and opens the gate
+void MotionGate::reset() {
+    background.release();
+    framesLeftOpen = 0;
+}
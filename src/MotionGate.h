@@ -0,0 +1,45 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+
+/// @brief Cheap presence check that lets the pipeline idle while nothing in front of the camera changes.
+/**
+ * Each frame is shrunk to a thumbnail about 80 pixels wide, converted to grayscale, blurred and compared with a
+ * running-average background. When enough thumbnail pixels differ from the background the gate opens, and it stays
+ * open for a hangover period after the last motion so a person standing still at the door is not cut off. Costs a
+ * few microseconds per frame, so the detector and recognizer only run when something may actually be there.
+ *
+ * The background slowly adapts to lighting changes; a sudden global change (lights switched on) simply opens the
+ * gate once until the background catches up.
+ *
+ * @file MotionGate.h
+ */
+class MotionGate {
+public:
+    /// @brief Constructor sets how long the gate stays open after motion
+    /**
+     * @param hangoverFrames Number of frames the gate stays open after the last frame with motion.
+     * @param minChangedFraction Fraction of thumbnail pixels that must change for a frame to count as motion.
+     */
+    explicit MotionGate(int hangoverFrames = 45, double minChangedFraction = 0.004);
+
+    /// @brief Compare a frame with the background and decide whether it should be processed
+    /**
+     * @param frame The BGR frame as captured.
+     * @param keepOpen Keeps the gate open regardless of motion, e.g. while faces are being tracked.
+     * @return true if the frame should go through detection and recognition.
+     */
+    bool update(const cv::Mat& frame, bool keepOpen);
+
+    /// @brief Forget the background; the next frame rebuilds it and opens the gate
+    void reset();
+
+private:
+    int hangoverFrames;
+    double minChangedFraction;
+    int framesLeftOpen = 0;
+    cv::Mat background;   ///< Running average of the blurred thumbnails, CV_32F
+    cv::Mat thumbnail;
+    cv::Mat difference;
+};
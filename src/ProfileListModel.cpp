@@ -0,0 +1,72 @@
+#include "ProfileListModel.h"
+
+/**
+ * @brief The employee names of a ProfileStore as a list model, filtered by an incremental search.
+ * @file ProfileListModel.cpp
+ */
+
+/// @brief Constructor takes the names from a profile store
+/**
+ * @param profiles The store whose names are listed.
+ * @param parent The parent object.
+ */
+ProfileListModel::ProfileListModel(std::shared_ptr<ProfileStore> profiles, QObject *parent)
+    : QAbstractListModel(parent),
+      profiles(std::move(profiles)) {
+    reload();
+}
+
+/// @brief Number of names matching the search
+int ProfileListModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(visible.size());
+}
+
+/// @brief Name of a matching row for Qt::DisplayRole
+QVariant ProfileListModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= static_cast<int>(visible.size()) || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    return names[visible[index.row()]];
+}
+
+/// @brief Show only the names containing a text, ignoring case
+/**
+ * @param text The search text; empty shows every name.
+ *
+ * When the new text extends the previous one, only the rows that matched it can still match, so only those are
+ * searched.
+ */
+void ProfileListModel::setFilter(const QString &text) {
+    beginResetModel();
+    bool narrowing = !filter.isEmpty() && text.startsWith(filter, Qt::CaseInsensitive);
+    std::vector<int> matches;
+    if (narrowing) {
+        for (int row : visible) {
+            if (names[row].contains(text, Qt::CaseInsensitive)) {
+                matches.push_back(row);
+            }
+        }
+    } else {
+        for (int row = 0; row < static_cast<int>(names.size()); row++) {
+            if (text.isEmpty() || names[row].contains(text, Qt::CaseInsensitive)) {
+                matches.push_back(row);
+            }
+        }
+    }
+    visible.swap(matches);
+    filter = text;
+    endResetModel();
+}
+
+/// @brief Read the names from the profile store again, after profiles were added or removed
+void ProfileListModel::reload() {
+    std::vector<Profile> rows = profiles->list();
+    names.clear();
+    names.reserve(rows.size());
+    for (const auto &profile : rows) {
+        names.push_back(QString::fromStdString(profile.name));
+    }
+    QString text = filter;
+    filter.clear();
+    setFilter(text);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <memory>
+#include <vector>
+
+#include "ProfileStore.h"
+
+/// @brief The employee names of a ProfileStore as a list model, filtered by an incremental search.
+/**
+ * A QListView on this model only creates and paints the rows that are on screen, so the admin panel sidebar costs
+ * the same whatever the number of employees, where it used to build one button per line of names.csv. The model
+ * holds the names once, in file order, and the indexes of the rows that match the current search. Typing another
+ * character only searches the rows that matched before; any other change of the search text scans all names once.
+ *
+ * @file ProfileListModel.h
+ */
+class ProfileListModel : public QAbstractListModel {
+    Q_OBJECT
+public:
+    /// @brief Constructor takes the names from a profile store
+    /**
+     * @param profiles The store whose names are listed.
+     * @param parent The parent object.
+     */
+    explicit ProfileListModel(std::shared_ptr<ProfileStore> profiles, QObject *parent = nullptr);
+
+    /// @brief Number of names matching the search
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    /// @brief Name of a matching row for Qt::DisplayRole
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    /// @brief Show only the names containing a text, ignoring case
+    /**
+     * @param text The search text; empty shows every name.
+     */
+    void setFilter(const QString &text);
+
+    /// @brief Read the names from the profile store again, after profiles were added or removed
+    void reload();
+
+private:
+    std::shared_ptr<ProfileStore> profiles;
+    std::vector<QString> names;    ///< All names in file order
+    std::vector<int> visible;      ///< Indexes into names of the rows matching the filter
+    QString filter;
+};
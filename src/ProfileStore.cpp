@@ -0,0 +1,568 @@
+#include "ProfileStore.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief The employee profiles in names.csv, indexed by name and by recognizer label.
+ * @file ProfileStore.cpp
+ */
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/// Log records after which the log is folded into a new snapshot
+const std::size_t kCompactRecords = 256;
+
+/// Strip leading and trailing whitespace, including the '\r' left by CRLF files
+std::string trimmed(const std::string& text) {
+    const char* whitespace = " \t\r\n";
+    std::size_t first = text.find_first_not_of(whitespace);
+    if (first == std::string::npos) {
+        return "";
+    }
+    std::size_t last = text.find_last_not_of(whitespace);
+    return text.substr(first, last - first + 1);
+}
+
+/// Modification time of a file, the minimum time if it does not exist
+fs::file_time_type modified(const std::string& path) {
+    std::error_code error;
+    fs::file_time_type time = fs::last_write_time(path, error);
+    return error ? fs::file_time_type::min() : time;
+}
+
+/// Size of a file, 0 if it does not exist
+std::uintmax_t sizeOf(const std::string& path) {
+    std::error_code error;
+    std::uintmax_t size = fs::file_size(path, error);
+    return error ? 0 : size;
+}
+
+/// Profile from the fields of a name,dateJoined,permission,door line; missing trailing fields are left empty
+Profile profileOf(const std::string& line) {
+    std::vector<std::string> parts;
+    std::stringstream fields(line);
+    std::string field;
+    while (std::getline(fields, field, ',')) {
+        parts.push_back(field);
+    }
+    Profile profile;
+    if (!parts.empty()) profile.name = parts[0];
+    if (parts.size() > 1) profile.dateJoined = parts[1];
+    if (parts.size() > 2) profile.permission = parts[2];
+    if (parts.size() > 3) profile.door = trimmed(parts[3]);
+    return profile;
+}
+
+/// A profile as a names.csv line, without the newline
+std::string lineOf(const Profile& profile) {
+    return profile.name + "," + profile.dateJoined + "," + profile.permission + "," + profile.door;
+}
+
+/// 32-bit FNV-1a hash of a log record, as 8 hex digits
+std::string checksum(const std::string& text) {
+    std::uint32_t hash = 2166136261u;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    char digits[9];
+    std::snprintf(digits, sizeof(digits), "%08x", static_cast<unsigned>(hash));
+    return digits;
+}
+
+/// Read the non-empty lines of a CSV file as profiles
+bool readCsv(const std::string& csvPath, std::vector<Profile>& rows) {
+    std::ifstream file(csvPath);
+    if (!file.is_open()) {
+        std::cerr << "Error opening profiles file: " << csvPath << std::endl;
+        return false;
+    }
+    rows.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!trimmed(line).empty()) {
+            rows.push_back(profileOf(line));
+        }
+    }
+    return true;
+}
+
+/// Sync the directory holding a file, so a file created or renamed in it survives a power loss (no-op on Windows)
+void syncDirectory(const std::string& path) {
+#ifndef _WIN32
+    fs::path parent = fs::path(path).parent_path();
+    int directory = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY);
+    if (directory >= 0) {
+        ::fsync(directory);
+        ::close(directory);
+    }
+#else
+    (void)path;
+#endif
+}
+
+/// Write data to a file and wait until it is on disk, appending to or replacing the previous contents
+/**
+ * An append that fails part way is cut off again, so the file never keeps half a record for the next append to be
+ * written behind.
+ */
+bool writeSynced(const std::string& path, const std::string& data, bool append) {
+    std::error_code error;
+    bool created = !fs::exists(path, error);
+#ifdef _WIN32
+    int flags = _O_WRONLY | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC);
+    int file = _open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+    if (file < 0) {
+        return false;
+    }
+    __int64 start = _lseeki64(file, 0, SEEK_END);
+    bool written = data.empty() || _write(file, data.data(), static_cast<unsigned>(data.size())) ==
+                                   static_cast<int>(data.size());
+    if (!written && append && start >= 0) {
+        _chsize_s(file, start);
+    }
+    written = _commit(file) == 0 && written;
+    _close(file);
+#else
+    int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+    int file = ::open(path.c_str(), flags, 0644);
+    if (file < 0) {
+        return false;
+    }
+    off_t start = ::lseek(file, 0, SEEK_END);
+    bool written = true;
+    std::size_t done = 0;
+    while (done < data.size()) {
+        ssize_t count = ::write(file, data.data() + done, data.size() - done);
+        if (count <= 0) {
+            written = false;
+            break;
+        }
+        done += static_cast<std::size_t>(count);
+    }
+    if (!written && append && start >= 0 && ::ftruncate(file, start) != 0) {
+        std::cerr << "Warning: Unable to cut a partial write off " << path << std::endl;
+    }
+    written = ::fsync(file) == 0 && written;
+    ::close(file);
+#endif
+    if (created && written) {
+        syncDirectory(path);
+    }
+    return written;
+}
+
+/// Replace a file with new contents through a synced temporary file and a rename, so it is never seen half-written
+bool replaceFile(const std::string& path, const std::string& data) {
+    std::string temporary = path + ".tmp";
+    if (!writeSynced(temporary, data, false)) {
+        std::cerr << "Error: Unable to write " << temporary << std::endl;
+        return false;
+    }
+    std::error_code error;
+    fs::rename(temporary, path, error);
+    if (error) {
+        std::cerr << "Error: Unable to replace " << path << ": " << error.message() << std::endl;
+        return false;
+    }
+    // The rename itself only survives a power loss once the directory is synced
+    syncDirectory(path);
+    return true;
+}
+
+}
+
+/// @brief The store shared by everyone in this process that opens the same names.csv
+/**
+ * @param csvPath Path to names.csv.
+ * @param labelsPath Path to labels.txt, empty to index by name only.
+ * @return The shared store, loaded on the first call and refreshed on the following ones.
+ *
+ * The store lives as long as someone holds it; once the last holder lets go, the next open() loads it again.
+ */
+std::shared_ptr<ProfileStore> ProfileStore::open(const std::string& csvPath, const std::string& labelsPath) {
+    static std::mutex openMutex;
+    static std::map<std::string, std::weak_ptr<ProfileStore>> stores;
+    std::lock_guard<std::mutex> lock(openMutex);
+
+    std::shared_ptr<ProfileStore> store = stores[csvPath].lock();
+    if (store) {
+        bool hasLabels;
+        {
+            std::lock_guard<std::mutex> storeLock(store->mutex);
+            hasLabels = !store->labelsFile.empty();
+        }
+        if (!hasLabels && !labelsPath.empty()) {
+            store->loadLabels(labelsPath);
+        }
+        store->refresh();
+        return store;
+    }
+    store = std::make_shared<ProfileStore>();
+    store->load(csvPath);
+    if (!labelsPath.empty()) {
+        store->loadLabels(labelsPath);
+    }
+    stores[csvPath] = store;
+    return store;
+}
+
+/// @brief Parse a names.csv file and replay its log, replacing anything loaded before
+/**
+ * @param csvPath Path to names.csv. Each line is name,dateJoined,permission,door.
+ * @return true if the file was read, false if it could not be opened.
+ *
+ * Missing trailing fields are left empty. If a name appears more than once, the first line wins, which matches
+ * the line-by-line scan the GUI used to do.
+ */
+bool ProfileStore::load(const std::string& csvPath) {
+    std::lock_guard<std::mutex> lock(mutex);
+    csvFile = csvPath;
+    logFile = csvPath + ".log";
+    return parse(csvPath);
+}
+
+/// @brief Parse a labels.txt file to index the profiles by recognizer label
+/**
+ * @param labelsPath Path to labels.txt. Each line is label name.
+ * @return true if the file was read, false if it could not be opened.
+ */
+bool ProfileStore::loadLabels(const std::string& labelsPath) {
+    std::lock_guard<std::mutex> lock(mutex);
+    labelsFile = labelsPath;
+    bool loaded = parseLabels(labelsPath);
+    index();
+    return loaded;
+}
+
+/// @brief Reload names.csv, its log and labels.txt if they changed on disk since they were read
+/**
+ * @return true if anything was reloaded.
+ */
+bool ProfileStore::refresh() {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool reloaded = false;
+    if (!csvFile.empty() &&
+        (modified(csvFile) != csvTime || modified(logFile) != logTime || sizeOf(logFile) != logSize)) {
+        reloaded = parse(csvFile) || reloaded;
+    }
+    if (!labelsFile.empty() && modified(labelsFile) != labelsTime) {
+        reloaded = parseLabels(labelsFile) || reloaded;
+        index();
+    }
+    return reloaded;
+}
+
+/// @brief Find the profile for a name
+/**
+ * @param name Employee name.
+ * @param profile Receives the profile.
+ * @return true if the name is in the file, false otherwise.
+ */
+bool ProfileStore::find(const std::string& name, Profile& profile) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = byName.find(name);
+    if (it == byName.end()) {
+        return false;
+    }
+    profile = profiles[it->second];
+    return true;
+}
+
+/// @brief Find the profile for a recognizer label
+/**
+ * @param label Label from labels.txt.
+ * @param profile Receives the profile.
+ * @return true if the label belongs to a name in the file, false otherwise.
+ */
+bool ProfileStore::findByLabel(int label, Profile& profile) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = byLabel.find(label);
+    if (it == byLabel.end()) {
+        return false;
+    }
+    profile = profiles[it->second];
+    return true;
+}
+
+/// @brief All profiles in file order
+std::vector<Profile> ProfileStore::list() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return profiles;
+}
+
+/// @brief Number of profiles
+std::size_t ProfileStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return profiles.size();
+}
+
+/// @brief Change the fields of a profile, adding it if the name is new
+/**
+ * @param profile The profile, found by its name; the label is ignored.
+ * @return true if the change was logged to disk.
+ */
+bool ProfileStore::update(const Profile& profile) {
+    return update(std::vector<Profile>{profile});
+}
+
+/// @brief Change the fields of many profiles with one write to the log
+/**
+ * @param changed The profiles, each found by its name; new names are added.
+ * @return true if the changes were logged to disk.
+ *
+ * The records are synced to disk before the profiles in memory change, so a change that was reported is never lost.
+ */
+bool ProfileStore::update(const std::vector<Profile>& changed) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (csvFile.empty()) {
+        std::cerr << "Error: No profiles file to write" << std::endl;
+        return false;
+    }
+    // A record torn by a crash is ended first, so the new records start on a line of their own
+    std::string records = logTorn ? "\n" : "";
+    for (const auto& profile : changed) {
+        std::string line = lineOf(profile);
+        records += line + "," + checksum(line) + "\n";
+    }
+    if (!writeSynced(logFile, records, true)) {
+        std::cerr << "Error: Unable to append to " << logFile << std::endl;
+        return false;
+    }
+    logTime = modified(logFile);
+    logSize = sizeOf(logFile);
+    logRecords += changed.size();
+    logTorn = false;
+
+    bool added = false;
+    for (const auto& profile : changed) {
+        added = upsert(profile) || added;
+    }
+    if (added) {
+        index();
+    }
+    if (logRecords >= kCompactRecords) {
+        writeSnapshot();
+    }
+    return true;
+}
+
+/// @brief Replace all profiles, writing a new snapshot
+/**
+ * @param profiles The new profiles in file order.
+ * @return true if the snapshot was written.
+ */
+bool ProfileStore::replaceAll(const std::vector<Profile>& profiles) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // The log's records were made against the old profiles. Replayed over the new snapshot they would bring back
+    // dropped names and overwrite the new fields, so the log is folded into the current snapshot and emptied before
+    // the new snapshot is renamed into place; a crash in between leaves the old profiles with all their edits.
+    if (!csvFile.empty() && sizeOf(logFile) > 0) {
+        parse(csvFile);
+        if (!writeSnapshot()) {
+            return false;
+        }
+    }
+    this->profiles = profiles;
+    index();
+    return writeSnapshot();
+}
+
+/// @brief Write the current profiles as the new names.csv snapshot and empty the log
+/**
+ * @return true if the snapshot was written.
+ */
+bool ProfileStore::compact() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (logRecords == 0 && !logTorn) || writeSnapshot();
+}
+
+/// @brief Replace all profiles with the rows of a CSV file
+/**
+ * @param csvPath File with name,dateJoined,permission,door lines.
+ * @return true if the file was read and the new snapshot written.
+ */
+bool ProfileStore::importCsv(const std::string& csvPath) {
+    std::vector<Profile> rows;
+    if (!readCsv(csvPath, rows)) {
+        return false;
+    }
+    return replaceAll(rows);
+}
+
+/// @brief Write the current profiles to a CSV file
+/**
+ * @param csvPath File to write; it is replaced atomically.
+ * @return true if the file was written.
+ */
+bool ProfileStore::exportCsv(const std::string& csvPath) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string data;
+    for (const auto& profile : profiles) {
+        data += lineOf(profile) + "\n";
+    }
+    return replaceFile(csvPath, data);
+}
+
+/// @brief Read the snapshot and replay the log over it; the caller holds the lock
+/**
+ * Only reads: a torn or corrupt record is skipped, never repaired here, since the log may belong to a writer in
+ * another process that is appending to it right now. The next update() or compact() of this store deals with it.
+ */
+bool ProfileStore::parse(const std::string& csvPath) {
+    csvTime = modified(csvPath);
+    std::vector<Profile> rows;
+    if (!readCsv(csvPath, rows)) {
+        return false;
+    }
+    profiles = std::move(rows);
+    index();
+    replayLog();
+    return true;
+}
+
+/// @brief Apply the records of the log to the profiles; false if a record was torn or corrupt
+/**
+ * A line whose checksum does not match is skipped and the replay goes on at the next line. A last record without
+ * its newline is ignored and remembered in logTorn, as it may still be being written.
+ */
+bool ProfileStore::replayLog() {
+    logTime = modified(logFile);
+    logSize = sizeOf(logFile);
+    logRecords = 0;
+    logTorn = false;
+    std::ifstream file(logFile, std::ios::binary);
+    if (!file.is_open()) {
+        return true;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string log = contents.str();
+
+    bool added = false;
+    std::size_t skipped = 0;
+    std::size_t start = 0;
+    while (start < log.size()) {
+        std::size_t end = log.find('\n', start);
+        if (end == std::string::npos) {
+            logTorn = true;
+            break;
+        }
+        std::size_t separator = log.rfind(',', end);
+        if (separator == std::string::npos || separator < start ||
+            log.compare(separator + 1, end - separator - 1, checksum(log.substr(start, separator - start))) != 0) {
+            // A record torn by an earlier crash, ended by the next append; the records after it are intact
+            if (end > start) {
+                skipped++;
+            }
+            start = end + 1;
+            continue;
+        }
+        added = upsert(profileOf(log.substr(start, separator - start))) || added;
+        logRecords++;
+        start = end + 1;
+    }
+    if (added) {
+        index();
+    }
+    if (skipped > 0 || logTorn) {
+        std::cerr << "Warning: Ignoring " << skipped + (logTorn ? 1 : 0) << " torn record(s) in " << logFile
+                  << ", replayed " << logRecords << " intact ones" << std::endl;
+    }
+    return skipped == 0 && !logTorn;
+}
+
+/// @brief Overwrite the fields of the profile with the same name, or add it; true if it was added
+bool ProfileStore::upsert(const Profile& profile) {
+    auto it = byName.find(profile.name);
+    if (it == byName.end()) {
+        byName.emplace(profile.name, profiles.size());
+        profiles.push_back(profile);
+        return true;
+    }
+    Profile& row = profiles[it->second];
+    row.dateJoined = profile.dateJoined;
+    row.permission = profile.permission;
+    row.door = profile.door;
+    return false;
+}
+
+/// @brief Read labels.txt; the caller holds the lock and rebuilds the index
+bool ProfileStore::parseLabels(const std::string& labelsPath) {
+    labelsTime = modified(labelsPath);
+    std::ifstream file(labelsPath);
+    if (!file.is_open()) {
+        std::cerr << "Error opening labels file: " << labelsPath << std::endl;
+        return false;
+    }
+    labelNames.clear();
+    int label;
+    std::string name;
+    while (file >> label >> name) {
+        labelNames[label] = name;
+    }
+    return true;
+}
+
+/// @brief Rebuild the name and label indexes after the rows or the labels changed
+void ProfileStore::index() {
+    byName.clear();
+    byLabel.clear();
+    byName.reserve(profiles.size());
+    for (std::size_t i = 0; i < profiles.size(); i++) {
+        profiles[i].label = -1;
+        byName.emplace(profiles[i].name, i);
+    }
+    for (const auto& entry : labelNames) {
+        auto row = byName.find(entry.second);
+        if (row != byName.end()) {
+            profiles[row->second].label = entry.first;
+            byLabel[entry.first] = row->second;
+        }
+    }
+}
+
+/// @brief Write all rows as the new snapshot, then empty the log; the caller holds the lock
+/**
+ * @return true if the snapshot was written and the log emptied.
+ *
+ * Only safe for snapshots that already hold every record of the log, as compaction writes them: a crash after the
+ * rename but before the log is emptied replays the log over the new snapshot, which changes nothing. replaceAll()
+ * empties the log this way before it writes profiles the log does not describe.
+ */
+bool ProfileStore::writeSnapshot() {
+    if (csvFile.empty()) {
+        std::cerr << "Error: No profiles file to write" << std::endl;
+        return false;
+    }
+    std::string data;
+    for (const auto& profile : profiles) {
+        data += lineOf(profile) + "\n";
+    }
+    if (!replaceFile(csvFile, data)) {
+        return false;
+    }
+    csvTime = modified(csvFile);
+    if (!writeSynced(logFile, "", false)) {
+        std::cerr << "Error: Unable to empty " << logFile << std::endl;
+        return false;
+    }
+    logTime = modified(logFile);
+    logSize = sizeOf(logFile);
+    logRecords = 0;
+    logTorn = false;
+    return true;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/// @brief One employee row of names.csv
+struct Profile {
+    std::string name;         ///< Employee name, matches the dataset folder and the recognizer label
+    std::string dateJoined;   ///< Date the profile was created
+    std::string permission;   ///< Job status / permission level (Admin, Manager, Employee)
+    std::string door;         ///< Door number the employee may open
+    int label = -1;           ///< Recognizer label of the employee from labels.txt, -1 if not enrolled
+};
+
+
+/// @brief The employee profiles in names.csv, indexed by name and by recognizer label.
+/**
+ * The file is parsed once and every lookup afterwards is a hash lookup, so no file I/O happens per decision or per
+ * row of the admin panel. Profiles keep the order of the file. labels.txt is read alongside, so the GUI and the
+ * daemon look a decision up by the label it was voted on, while the admin panel finds profiles by name.
+ *
+ * names.csv is the snapshot of the profiles. Edits are not written into it: update() appends one record per changed
+ * profile to names.csv.log next to it and syncs it to disk, so an edit costs one short write whatever the number of
+ * profiles; an append that fails part way is cut off again. Loading replays the log over the snapshot. Every record
+ * carries a checksum and ends with a newline, so a record torn by a power loss is recognized and skipped, and the
+ * edits before and after it survive. Loading and refresh() only read; the log is only rewritten by the store that
+ * edits, so a reader never truncates it under a writer in another process. Once the log holds
+ * kCompactRecords records, compact() writes the current profiles to a temporary file, syncs it and renames it over
+ * names.csv before emptying the log; a crash at any point leaves either the old or the new snapshot, and replaying
+ * the log again over the new one changes nothing. replaceAll() and importCsv() write profiles the log's records do
+ * not apply to, so they first fold the log into the current snapshot and empty it, and only then rename the new
+ * snapshot into place. names.csv stays a plain CSV file, so importCsv() and exportCsv()
+ * exchange profiles with other tools.
+ *
+ * The GUI and the admin panel share one store per file through open(). refresh() reloads the files when they changed
+ * on disk since they were read, e.g. after a retraining or an edit by another program, and costs one stat per file
+ * otherwise. The store is safe to use from several threads of one process; lookups return copies.
+ *
+ * It uses no Qt and can be used by the headless daemon as well as the GUI.
+ *
+ * @file ProfileStore.h
+ */
+class ProfileStore {
+public:
+    /// @brief The store shared by everyone in this process that opens the same names.csv
+    /**
+     * @param csvPath Path to names.csv.
+     * @param labelsPath Path to labels.txt, empty to index by name only.
+     * @return The shared store, loaded on the first call and refreshed on the following ones.
+     */
+    static std::shared_ptr<ProfileStore> open(const std::string& csvPath, const std::string& labelsPath = "");
+
+    /// @brief Parse a names.csv file and replay its log, replacing anything loaded before
+    /**
+     * @param csvPath Path to names.csv. Each line is name,dateJoined,permission,door.
+     * @return true if the file was read, false if it could not be opened.
+     */
+    bool load(const std::string& csvPath);
+
+    /// @brief Parse a labels.txt file to index the profiles by recognizer label
+    /**
+     * @param labelsPath Path to labels.txt. Each line is label name.
+     * @return true if the file was read, false if it could not be opened.
+     */
+    bool loadLabels(const std::string& labelsPath);
+
+    /// @brief Reload names.csv, its log and labels.txt if they changed on disk since they were read
+    /**
+     * @return true if anything was reloaded.
+     */
+    bool refresh();
+
+    /// @brief Find the profile for a name
+    /**
+     * @param name Employee name.
+     * @param profile Receives the profile.
+     * @return true if the name is in the file, false otherwise.
+     */
+    bool find(const std::string& name, Profile& profile) const;
+
+    /// @brief Find the profile for a recognizer label
+    /**
+     * @param label Label from labels.txt.
+     * @param profile Receives the profile.
+     * @return true if the label belongs to a name in the file, false otherwise.
+     */
+    bool findByLabel(int label, Profile& profile) const;
+
+    /// @brief All profiles in file order
+    std::vector<Profile> list() const;
+
+    /// @brief Number of profiles
+    std::size_t size() const;
+
+    /// @brief Change the fields of a profile, adding it if the name is new
+    /**
+     * @param profile The profile, found by its name; the label is ignored.
+     * @return true if the change was logged to disk.
+     */
+    bool update(const Profile& profile);
+
+    /// @brief Change the fields of many profiles with one write to the log
+    /**
+     * @param changed The profiles, each found by its name; new names are added.
+     * @return true if the changes were logged to disk.
+     */
+    bool update(const std::vector<Profile>& changed);
+
+    /// @brief Replace all profiles, writing a new snapshot
+    /**
+     * @param profiles The new profiles in file order.
+     * @return true if the snapshot was written.
+     */
+    bool replaceAll(const std::vector<Profile>& profiles);
+
+    /// @brief Write the current profiles as the new names.csv snapshot and empty the log
+    /**
+     * @return true if the snapshot was written.
+     */
+    bool compact();
+
+    /// @brief Replace all profiles with the rows of a CSV file
+    /**
+     * @param csvPath File with name,dateJoined,permission,door lines.
+     * @return true if the file was read and the new snapshot written.
+     */
+    bool importCsv(const std::string& csvPath);
+
+    /// @brief Write the current profiles to a CSV file
+    /**
+     * @param csvPath File to write; it is replaced atomically.
+     * @return true if the file was written.
+     */
+    bool exportCsv(const std::string& csvPath) const;
+
+private:
+    bool parse(const std::string& csvPath);
+    bool parseLabels(const std::string& labelsPath);
+    bool replayLog();
+    bool upsert(const Profile& profile);
+    void index();
+    bool writeSnapshot();
+
+    mutable std::mutex mutex;
+    std::string csvFile;
+    std::string logFile;             ///< names.csv.log, the edits made since the snapshot was written
+    std::string labelsFile;
+    std::filesystem::file_time_type csvTime;
+    std::filesystem::file_time_type logTime;
+    std::uintmax_t logSize = 0;
+    std::size_t logRecords = 0;      ///< Records in the log, compacted once it reaches kCompactRecords
+    bool logTorn = false;            ///< The log ends in a record without its newline
+    std::filesystem::file_time_type labelsTime;
+    std::vector<Profile> profiles;                    ///< Rows of names.csv in file order
+    std::unordered_map<std::string, std::size_t> byName;   ///< Index of the first row with each name
+    std::unordered_map<int, std::size_t> byLabel;          ///< Index of the row of each enrolled label
+    std::map<int, std::string> labelNames;            ///< Label to name, as in labels.txt
+};
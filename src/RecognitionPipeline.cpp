@@ -0,0 +1,291 @@
+#include "RecognitionPipeline.h"
+#include <cfloat>
+#include <utility>
+
+/**
+ * @brief Runs detection, recognition and rendering as separate stages, each on its own thread.
+ * @file RecognitionPipeline.cpp
+ */
+
+namespace {
+
+/// Distances at or below this share of the recognizer's threshold are not voted on; 7 at the model's threshold of 100
+const double kMinDistanceShare = 0.07;
+
+/// The GUI's original gate, used when the recognizer has no threshold to scale it by
+const double kMinDistance = 7.0;
+
+}
+
+/// @brief Constructor binds the pipeline to the models it runs
+/**
+ * @param detector Face detector used by the detect stage. It must outlive the pipeline.
+ * @param recognizer Trained recognizer used by the recognize stage, possibly shared with other pipelines.
+ * @param queueDepth Number of frames each inter-stage queue holds before blocking its producer.
+ */
+RecognitionPipeline::RecognitionPipeline(FaceDetector& detector,
+    std::shared_ptr<const FaceRecognizerWrapper> recognizer, std::size_t queueDepth)
+    : detector(detector),
+      recognizer(std::move(recognizer)),
+      detectedQueue(queueDepth),
+      recognizedQueue(queueDepth) {
+}
+
+/// @brief Destructor stops the stage threads
+RecognitionPipeline::~RecognitionPipeline() {
+    stop();
+}
+
+/// @brief Set the function that receives finished frames. Must be set before start().
+void RecognitionPipeline::setResultCallback(ResultCallback callback) {
+    onResult = std::move(callback);
+}
+
+/// @brief Enable or disable the render stage's overlay drawing and RGB conversion (on by default)
+void RecognitionPipeline::setRenderEnabled(bool enabled) {
+    renderEnabled = enabled;
+}
+
+/// @brief Run the face detector on one frame out of this many (default 5), tracking faces in between
+/**
+ * 1 restores detection on every frame. Must be set before start().
+ */
+void RecognitionPipeline::setDetectInterval(int interval) {
+    tracker.setDetectInterval(interval);
+}
+
+/// @brief Enable or disable skipping detection and recognition while the scene is static (on by default)
+/**
+ * Skipped frames still reach the render stage and the result callback, with no faces, so a display keeps
+ * updating. Must be set before start().
+ */
+void RecognitionPipeline::setMotionGateEnabled(bool enabled) {
+    motionGateEnabled = enabled;
+}
+
+/// @brief Set how faces are cropped before recognition, see loadPreprocessConfig()
+/**
+ * Must match the settings the model was trained with. The defaults match models trained without a
+ * preprocess.yml. Must be set before start().
+ */
+void RecognitionPipeline::setPreprocessParams(const PreprocessParams& params) {
+    preprocessor = FacePreprocessor(params);
+}
+
+/// @brief Start the stage threads, pulling frames from the given ring
+/**
+ * @param source Ring the capture thread publishes into. It must outlive the pipeline.
+ */
+void RecognitionPipeline::start(FrameRing<TimestampedFrame>& source) {
+    stop();
+    detectedQueue.reopen();
+    recognizedQueue.reopen();
+    tracker.reset();
+    motionGate.reset();
+    detectorRunCount = 0;
+    fullScanCount = 0;
+    idleFrameCount = 0;
+    sourceEnded = false;
+    finished = false;
+    running = true;
+    detectThread = std::thread(&RecognitionPipeline::detectLoop, this, &source);
+    recognizeThread = std::thread(&RecognitionPipeline::recognizeLoop, this);
+    renderThread = std::thread(&RecognitionPipeline::renderLoop, this);
+}
+
+/// @brief Stop and join the stage threads. Frames still in flight are discarded.
+/**
+ * The detect thread notices the flag within one ring wait; closing the queues unblocks the downstream stages.
+ */
+void RecognitionPipeline::stop() {
+    running = false;
+    detectedQueue.close();
+    recognizedQueue.close();
+    if (detectThread.joinable()) {
+        detectThread.join();
+    }
+    if (recognizeThread.joinable()) {
+        recognizeThread.join();
+    }
+    if (renderThread.joinable()) {
+        renderThread.join();
+    }
+}
+
+/// @brief Replace the recognizer without stopping the pipeline
+/**
+ * May be called from any thread. Frames already being recognized finish with the previous model, which is
+ * released once the last of them is done; the next frame uses the new one.
+ *
+ * @param next The newly loaded recognizer.
+ */
+void RecognitionPipeline::setRecognizer(std::shared_ptr<const FaceRecognizerWrapper> next) {
+    std::atomic_store(&recognizer, std::move(next));
+}
+
+/// @brief While paused, frames are taken from the ring and dropped without being processed
+void RecognitionPipeline::setPaused(bool pause) {
+    paused = pause;
+}
+
+/// @brief Whether the stage threads are running
+bool RecognitionPipeline::isRunning() const {
+    return running;
+}
+
+/// @brief Whether the source ring was closed and every frame taken from it has been delivered
+bool RecognitionPipeline::isFinished() const {
+    return finished;
+}
+
+/// @brief Number of frames the face detector has run on since start()
+std::size_t RecognitionPipeline::detectorRuns() const {
+    return detectorRunCount;
+}
+
+/// @brief Number of those detector runs that scanned the whole frame
+std::size_t RecognitionPipeline::fullScanRuns() const {
+    return fullScanCount;
+}
+
+/// @brief Number of frames the motion gate let through without detection since start()
+std::size_t RecognitionPipeline::idleFrames() const {
+    return idleFrameCount;
+}
+
+/// @brief Detect stage: grayscale conversion and face detection
+/**
+ * @param source Ring to pull frames from. Only the newest frame is taken and older ones are dropped, unless the
+ *               ring is lossless, in which case every frame is taken in order.
+ *
+ * The detector runs when the tracker asks for it, on a schedule or after a track was lost; on all other frames the
+ * tracker follows the faces it already knows. Most detection passes only search around the current tracks, with a
+ * full-frame scan when the tracker asks for one. Frames skipped while paused reset the tracker, since the scene may
+ * have changed completely.
+ *
+ * In front of all of this the motion gate decides whether the frame is worth looking at. It stays open while any
+ * face is tracked; once the scene has been static for its hangover period, frames are passed on marked idle,
+ * without a grayscale conversion, detection or recognition, and the first frame with motion is detected at once.
+ *
+ * Once the ring is closed and empty the stage ends, and the downstream stages drain what is left.
+ */
+void RecognitionPipeline::detectLoop(FrameRing<TimestampedFrame>* source) {
+    while (running) {
+        FrameResult result;
+        if (!source->waitNext(result.frame, std::chrono::milliseconds(100))) {
+            if (source->isClosed() && source->empty()) {
+                sourceEnded = true;
+                break;
+            }
+            continue;
+        }
+        if (paused) {
+            tracker.reset();
+            motionGate.reset();
+            continue;
+        }
+
+        if (motionGateEnabled && !motionGate.update(result.frame.image, !tracker.tracks().empty())) {
+            result.idle = true;
+            idleFrameCount++;
+            tracker.reset();
+            if (!detectedQueue.push(std::move(result))) {
+                break;
+            }
+            continue;
+        }
+
+        cv::cvtColor(result.frame.image, result.gray, cv::COLOR_BGR2GRAY);
+        if (tracker.detectionDue()) {
+            if (tracker.fullScanDue()) {
+                tracker.update(result.gray, detector.detectFaces(result.gray), true);
+                fullScanCount++;
+            } else {
+                tracker.update(result.gray, detector.detectAround(result.gray, tracker.regions()), false);
+            }
+            detectorRunCount++;
+        } else {
+            tracker.propagate(result.gray);
+        }
+        for (const auto& track : tracker.tracks()) {
+            FaceMatch match;
+            match.rect = track.rect;
+            match.trackId = track.id;
+            result.faces.push_back(match);
+        }
+
+        if (!detectedQueue.push(std::move(result))) {
+            break;
+        }
+    }
+    detectedQueue.close();
+}
+
+/// @brief Recognize stage: predict a label for every detected face
+/**
+ * A face is accepted for voting when its confidence is greater than 7% of the recognizer's accept threshold, the
+ * GUI's original gate of 7 at the model's threshold of 100 carried over to the distance scale of the gallery in use
+ * (a compact gallery measures smaller distances, see LbphGallery::acceptThreshold()). Only accepted faces carry
+ * their label's name, everything else stays "Unknown". The recognizer is fetched once
+ * per frame, so a model swapped in by setRecognizer() never mixes with the previous one within a frame, and all faces
+ * of the frame are predicted together by predictBatch().
+ */
+void RecognitionPipeline::recognizeLoop() {
+    FrameResult result;
+    std::vector<cv::Mat> crops;
+    std::vector<int> labels;
+    std::vector<double> confidences;
+    while (detectedQueue.pop(result)) {
+        std::shared_ptr<const FaceRecognizerWrapper> model = std::atomic_load(&recognizer);
+        // Crops keep their buffers from frame to frame; all faces are then matched together in one gallery pass
+        crops.resize(result.faces.size());
+        for (std::size_t i = 0; i < result.faces.size(); i++) {
+            preprocessor.apply(result.gray(result.faces[i].rect), crops[i]);
+        }
+        model->predictBatch(crops, labels, confidences);
+        double threshold = model->getGallery()->acceptThreshold();
+        double minDistance = threshold < DBL_MAX ? kMinDistanceShare * threshold : kMinDistance;
+        for (std::size_t i = 0; i < result.faces.size(); i++) {
+            auto& face = result.faces[i];
+            face.label = labels[i];
+            face.confidence = confidences[i];
+            face.accepted = face.confidence > minDistance;
+            if (face.accepted) {
+                face.name = model->getLabelName(face.label);
+            }
+        }
+        if (!recognizedQueue.push(std::move(result))) {
+            break;
+        }
+    }
+    recognizedQueue.close();
+}
+
+/// @brief Render stage: draw overlays, convert to RGB and hand the frame to the result callback
+void RecognitionPipeline::renderLoop() {
+    FrameResult result;
+    while (recognizedQueue.pop(result)) {
+        if (renderEnabled) {
+            cv::Mat& frame = result.frame.image;
+            for (const auto& face : result.faces) {
+                cv::rectangle(frame, face.rect, cv::Scalar(0, 255, 0), 2);
+                cv::putText(frame, face.name, cv::Point(face.rect.x, face.rect.y - 5),
+                            cv::FONT_HERSHEY_DUPLEX, 1.0, cv::Scalar(0, 255, 0), 1);
+            }
+
+            int thickness = 4;
+            cv::rectangle(frame,
+                          cv::Point(0, 0),
+                          cv::Point(frame.cols - 1, frame.rows - 1),
+                          cv::Scalar(255, 255, 255),
+                          thickness);
+
+            cv::cvtColor(frame, result.rendered, cv::COLOR_BGR2RGB);
+        }
+        if (onResult) {
+            onResult(std::move(result));
+        }
+        result = FrameResult();
+    }
+    finished = sourceEnded.load();
+}
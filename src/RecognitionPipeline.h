@@ -0,0 +1,170 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "FaceDetector.h"
+#include "FacePreprocessor.h"
+#include "FaceRecognizerWrapper.h"
+#include "FaceTracker.h"
+#include "FrameGrabber.h"
+#include "MotionGate.h"
+
+
+/// @brief One face found in a frame and what the recognizer made of it
+struct FaceMatch {
+    cv::Rect rect;                 ///< Bounding box in full-frame coordinates
+    int trackId = 0;               ///< ID of the track following this face, stable across frames
+    int label = -1;                ///< Predicted label, -1 if the recognizer rejected the face
+    double confidence = 0.0;       ///< LBPH distance reported by the recognizer
+    bool accepted = false;         ///< Whether the prediction passed the confidence gate and should be voted on
+    std::string name = "Unknown";  ///< Name drawn on the frame and used for voting
+};
+
+
+/// @brief Everything the pipeline produced for one captured frame
+struct FrameResult {
+    TimestampedFrame frame;        ///< The captured frame; overlays are drawn onto it by the render stage
+    cv::Mat gray;                  ///< Grayscale copy used for detection and recognition (empty if idle)
+    bool idle = false;             ///< Whether the motion gate skipped detection and recognition for this frame
+    std::vector<FaceMatch> faces;  ///< Detected faces in detection order
+    cv::Mat rendered;              ///< RGB frame with overlays, ready for display (empty if rendering is off)
+};
+
+
+/// @brief Runs detection, recognition and rendering as separate stages, each on its own thread.
+/**
+ * The pipeline pulls the next frame from a FrameGrabber's ring and passes it through three workers:
+ * - detect: skips frames in which a MotionGate sees no change, converts the rest to grayscale and finds faces, running the detector only every few frames and following the
+ *   faces with a FaceTracker in between; most detector runs only search the regions around known faces,
+ * - recognize: crops every face with a FacePreprocessor, as training does, and predicts their labels,
+ * - render: draws boxes, names and the frame border, and converts to RGB.
+ *
+ * Stages are connected by bounded queues, so frame N+1 can be detected while frame N is being recognized, and a
+ * slow stage applies backpressure upstream rather than letting frames pile up. Frames leave the pipeline in
+ * capture order. The result callback is invoked on the render thread.
+ *
+ * The detector is only ever used by this pipeline's detect thread. The recognizer is only read from, so several
+ * pipelines (one per camera) can share the same loaded model. setRecognizer() swaps in a new model while the
+ * pipeline runs; each frame is recognized entirely with the model that was current when its recognition started.
+ *
+ * @file RecognitionPipeline.h
+ */
+class RecognitionPipeline {
+public:
+    /// Function that receives every finished frame, called on the render thread
+    using ResultCallback = std::function<void(FrameResult&&)>;
+
+    /// @brief Constructor binds the pipeline to the models it runs
+    /**
+     * @param detector Face detector used by the detect stage. It must outlive the pipeline.
+     * @param recognizer Trained recognizer used by the recognize stage, possibly shared with other pipelines.
+     * @param queueDepth Number of frames each inter-stage queue holds before blocking its producer.
+     */
+    RecognitionPipeline(FaceDetector& detector, std::shared_ptr<const FaceRecognizerWrapper> recognizer,
+        std::size_t queueDepth = 2);
+
+    /// @brief Destructor stops the stage threads
+    ~RecognitionPipeline();
+
+    RecognitionPipeline(const RecognitionPipeline&) = delete;
+    RecognitionPipeline& operator=(const RecognitionPipeline&) = delete;
+
+    /// @brief Set the function that receives finished frames. Must be set before start().
+    void setResultCallback(ResultCallback callback);
+
+    /// @brief Enable or disable the render stage's overlay drawing and RGB conversion (on by default)
+    void setRenderEnabled(bool enabled);
+
+    /// @brief Run the face detector on one frame out of this many (default 5), tracking faces in between
+    /**
+     * 1 restores detection on every frame. Must be set before start().
+     */
+    void setDetectInterval(int interval);
+
+    /// @brief Enable or disable skipping detection and recognition while the scene is static (on by default)
+    /**
+     * Skipped frames still reach the render stage and the result callback, with no faces, so a display keeps
+     * updating. Must be set before start().
+     */
+    void setMotionGateEnabled(bool enabled);
+
+    /// @brief Set how faces are cropped before recognition, see loadPreprocessConfig()
+    /**
+     * Must match the settings the model was trained with. The defaults match models trained without a
+     * preprocess.yml. Must be set before start().
+     */
+    void setPreprocessParams(const PreprocessParams& params);
+
+    /// @brief Start the stage threads, pulling frames from the given ring
+    /**
+     * @param source Ring the capture thread publishes into. It must outlive the pipeline.
+     */
+    void start(FrameRing<TimestampedFrame>& source);
+
+    /// @brief Stop and join the stage threads. Frames still in flight are discarded.
+    void stop();
+
+    /// @brief Replace the recognizer without stopping the pipeline
+    /**
+     * May be called from any thread. Frames already being recognized finish with the previous model, which is
+     * released once the last of them is done; the next frame uses the new one.
+     *
+     * @param next The newly loaded recognizer.
+     */
+    void setRecognizer(std::shared_ptr<const FaceRecognizerWrapper> next);
+
+    /// @brief While paused, frames are taken from the ring and dropped without being processed
+    void setPaused(bool pause);
+
+    /// @brief Whether the stage threads are running
+    bool isRunning() const;
+
+    /// @brief Whether the source ring was closed and every frame taken from it has been delivered
+    /**
+     * Becomes true after a replayed recording has been fully processed, so callers can wait for the end of a run.
+     */
+    bool isFinished() const;
+
+    /// @brief Number of frames the face detector has run on since start()
+    std::size_t detectorRuns() const;
+
+    /// @brief Number of those detector runs that scanned the whole frame
+    std::size_t fullScanRuns() const;
+
+    /// @brief Number of frames the motion gate let through without detection since start()
+    std::size_t idleFrames() const;
+
+private:
+    void detectLoop(FrameRing<TimestampedFrame>* source);
+    void recognizeLoop();
+    void renderLoop();
+
+    FaceDetector& detector;
+    std::shared_ptr<const FaceRecognizerWrapper> recognizer;   ///< Only accessed through std::atomic_load/store
+    ResultCallback onResult;
+    bool renderEnabled = true;
+    FaceTracker tracker;
+    MotionGate motionGate;
+    bool motionGateEnabled = true;
+    FacePreprocessor preprocessor;   ///< Only used by the recognize thread
+
+    BoundedQueue<FrameResult> detectedQueue;
+    BoundedQueue<FrameResult> recognizedQueue;
+    std::thread detectThread;
+    std::thread recognizeThread;
+    std::thread renderThread;
+    std::atomic<bool> running{false};
+    std::atomic<bool> paused{false};
+    std::atomic<bool> sourceEnded{false};
+    std::atomic<bool> finished{false};
+    std::atomic<std::size_t> detectorRunCount{0};
+    std::atomic<std::size_t> fullScanCount{0};
+    std::atomic<std::size_t> idleFrameCount{0};
+};
@@ -0,0 +1,336 @@
+#include "TemporalVoter.h"
+#include <algorithm>
+#include <cfloat>
+
+/**
+ * @brief Smooths per-frame predictions into decisions by voting over each tracked face's recent predictions.
+ * @file TemporalVoter.cpp
+ */
+
+namespace {
+
+/// Frames a track may go without votes before it is forgotten, about three seconds of camera frames
+const std::size_t kTrackIdleFrames = 90;
+
+}
+
+/// @brief Constructor sets the number of votes the window holds
+LabelWindow::LabelWindow(std::size_t size)
+    : ring(std::max<std::size_t>(size, 1)),
+      bucketHead(ring.size() + 1, -1),
+      bucketTail(ring.size() + 1, -1) {
+}
+
+/// @brief Add a vote, evicting the oldest one once the window is full
+/**
+ * @param label Voted label, -1 or greater.
+ *
+ * The tables grow when a label higher than any seen before arrives; otherwise nothing is allocated.
+ */
+void LabelWindow::add(int label) {
+    int slot = std::max(label, -1) + 1;
+    if (filled == ring.size()) {
+        decrement(ring[next]);
+    } else {
+        filled++;
+    }
+    ring[next] = slot;
+    next = (next + 1) % ring.size();
+    increment(slot);
+}
+
+/// @brief Label with the most votes in the window, -1 if the window is empty
+int LabelWindow::leader() const {
+    return maxCount == 0 ? -1 : bucketHead[maxCount] - 1;
+}
+
+/// @brief Number of votes the leader has in the window
+int LabelWindow::leaderCount() const {
+    return maxCount;
+}
+
+/// @brief Number of votes for a label in the window
+int LabelWindow::count(int label) const {
+    int slot = std::max(label, -1) + 1;
+    return slot < static_cast<int>(counts.size()) ? counts[slot] : 0;
+}
+
+/// @brief Number of votes in the window
+std::size_t LabelWindow::votes() const {
+    return filled;
+}
+
+/// @brief Whether the window holds its full number of votes
+bool LabelWindow::full() const {
+    return filled == ring.size();
+}
+
+/// @brief Discard all votes
+void LabelWindow::clear() {
+    next = 0;
+    filled = 0;
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(bucketHead.begin(), bucketHead.end(), -1);
+    std::fill(bucketTail.begin(), bucketTail.end(), -1);
+    maxCount = 0;
+}
+
+/// @brief Move a slot one count up; it joins the back of its new count's list, behind labels already there
+void LabelWindow::increment(int slot) {
+    if (slot >= static_cast<int>(counts.size())) {
+        counts.resize(slot + 1, 0);
+        previous.resize(slot + 1, -1);
+        following.resize(slot + 1, -1);
+    }
+    if (counts[slot] > 0) {
+        unlink(slot);
+    }
+    counts[slot]++;
+    pushBack(slot);
+    maxCount = std::max(maxCount, counts[slot]);
+}
+
+/// @brief Move a slot one count down; it joins the front of its new count's list, as it had more votes than the rest
+void LabelWindow::decrement(int slot) {
+    unlink(slot);
+    counts[slot]--;
+    if (counts[slot] > 0) {
+        pushFront(slot);
+    }
+    // Counts change by one, so the maximum drops by at most one, to the count the slot just moved to
+    if (bucketHead[maxCount] < 0) {
+        maxCount--;
+    }
+}
+
+/// @brief Remove a slot from the list of its count
+void LabelWindow::unlink(int slot) {
+    int count = counts[slot];
+    if (previous[slot] >= 0) {
+        following[previous[slot]] = following[slot];
+    } else {
+        bucketHead[count] = following[slot];
+    }
+    if (following[slot] >= 0) {
+        previous[following[slot]] = previous[slot];
+    } else {
+        bucketTail[count] = previous[slot];
+    }
+    previous[slot] = -1;
+    following[slot] = -1;
+}
+
+/// @brief Insert a slot at the front of the list of its count
+void LabelWindow::pushFront(int slot) {
+    int count = counts[slot];
+    previous[slot] = -1;
+    following[slot] = bucketHead[count];
+    if (bucketHead[count] >= 0) {
+        previous[bucketHead[count]] = slot;
+    } else {
+        bucketTail[count] = slot;
+    }
+    bucketHead[count] = slot;
+}
+
+/// @brief Insert a slot at the back of the list of its count
+void LabelWindow::pushBack(int slot) {
+    int count = counts[slot];
+    following[slot] = -1;
+    previous[slot] = bucketTail[count];
+    if (bucketTail[count] >= 0) {
+        following[bucketTail[count]] = slot;
+    } else {
+        bucketHead[count] = slot;
+    }
+    bucketTail[count] = slot;
+}
+
+/// @brief Constructor sets the number of votes in one window and when decisions are made
+/**
+ * @param windowSize Number of accepted predictions per track a decision is based on.
+ * @param mode When decisions are made, see VoteMode.
+ * @param rule When a Sequential vote decides early.
+ */
+TemporalVoter::TemporalVoter(std::size_t windowSize, VoteMode mode, const SequentialRule& rule)
+    : windowSize(std::max<std::size_t>(windowSize, 1)),
+      mode(mode),
+      rule(rule) {
+}
+
+/// @brief Add one vote and report whether it produced a decision
+/**
+ * @param trackId Track of the face, see FaceMatch::trackId.
+ * @param label Label predicted for the face.
+ * @param distance LBPH distance of the prediction, DBL_MAX if the face was rejected.
+ * @param name Name of the label; the latest name given for a label is the one decisions report, so a label that a
+ *             retrained model gave to someone else is never reported under its old name.
+ * @param decision Receives the decision when the call returns true.
+ * @return true if a decision was made.
+ *
+ * The decision is the label with the most votes in the track's window. In Rounds mode the window is cleared after
+ * each decision; in Sliding mode it keeps sliding and the next decision waits for a different leader. In Sequential
+ * mode the round ends as soon as one label has enough evidence, see SequentialRule.
+ */
+bool TemporalVoter::addVote(int trackId, int label, double distance, const std::string& name,
+                            VoteDecision& decision) {
+    auto found = tracks.find(trackId);
+    if (found == tracks.end()) {
+        found = tracks.emplace(trackId, TrackVotes{LabelWindow(windowSize)}).first;
+    }
+    TrackVotes& track = found->second;
+    track.lastFrame = frame;
+    auto known = names.find(label);
+    if (known == names.end()) {
+        names.emplace(label, name);
+    } else if (known->second != name) {
+        known->second = name;
+    }
+    track.window.add(label);
+    track.sinceDecision++;
+
+    if (mode == VoteMode::Rounds) {
+        if (track.sinceDecision < windowSize) {
+            return false;
+        }
+        describe(trackId, track.window.leader(), track.window.leaderCount(), decision);
+        track.window.clear();
+        track.sinceDecision = 0;
+        return true;
+    }
+    if (mode == VoteMode::Sequential) {
+        int decided = -1;
+        if (!decideSequential(track, label, distance, decided)) {
+            return false;
+        }
+        int count = track.window.count(decided);
+        track.window.clear();
+        track.evidence.clear();
+        track.sinceDecision = 0;
+        // The face stays in front of the camera after its decision; only a change of mind is reported again
+        if (decided == track.decided) {
+            return false;
+        }
+        track.decided = decided;
+        describe(trackId, decided, count, decision);
+        return true;
+    }
+    if (!track.window.full() || track.window.leader() == track.decided) {
+        return false;
+    }
+    track.decided = track.window.leader();
+    describe(trackId, track.window.leader(), track.window.leaderCount(), decision);
+    return true;
+}
+
+/// @brief Add a vote's evidence to its track and check whether the track's round can be decided
+/**
+ * @param track The track, with the vote already added to its window.
+ * @param label Label of the vote.
+ * @param distance LBPH distance of the vote, DBL_MAX if the face was rejected.
+ * @param decided Receives the decided label when the call returns true.
+ * @return true if the leader's evidence clears the margin or the round reached windowSize votes.
+ *
+ * A track rarely sees more than two or three different labels in a round, so the evidence is kept in a short list
+ * and the leader and runner-up are found by scanning it.
+ */
+bool TemporalVoter::decideSequential(TrackVotes& track, int label, double distance, int& decided) const {
+    // A rejection is evidence against every enrolled label, so it counts for "Unknown" rather than for nobody
+    double weight = label >= 0 && distance < DBL_MAX
+                        ? rule.referenceDistance / (rule.referenceDistance + std::max(distance, 0.0))
+                        : rule.rejectionWeight;
+    auto entry = std::find_if(track.evidence.begin(), track.evidence.end(),
+                              [label](const std::pair<int, double>& item) { return item.first == label; });
+    if (entry == track.evidence.end()) {
+        track.evidence.emplace_back(label, weight);
+    } else {
+        entry->second += weight;
+    }
+
+    if (track.sinceDecision >= rule.minVotes) {
+        int best = -1;
+        double bestEvidence = 0.0;
+        double runnerUp = 0.0;
+        for (const auto& item : track.evidence) {
+            if (item.second > bestEvidence) {
+                runnerUp = bestEvidence;
+                bestEvidence = item.second;
+                best = item.first;
+            } else {
+                runnerUp = std::max(runnerUp, item.second);
+            }
+        }
+        if (bestEvidence > 0.0 && bestEvidence - runnerUp >= rule.margin) {
+            decided = best;
+            return true;
+        }
+    }
+    if (track.sinceDecision >= windowSize) {
+        decided = track.window.leader();
+        return true;
+    }
+    return false;
+}
+
+/// @brief The current leader of a track, in O(1)
+/**
+ * @param trackId Track of the face.
+ * @param current Receives the label with the most votes in the track's window and its count.
+ * @return true if the track has votes, false otherwise.
+ */
+bool TemporalVoter::leader(int trackId, VoteDecision& current) const {
+    auto found = tracks.find(trackId);
+    if (found == tracks.end() || found->second.window.votes() == 0) {
+        return false;
+    }
+    describe(trackId, found->second.window.leader(), found->second.window.leaderCount(), current);
+    return true;
+}
+
+/// @brief Mark the end of a frame, forgetting tracks that have not been voted for in a while
+/**
+ * Call once per processed frame, after its votes. A face that leaves and comes back gets a new track and starts
+ * voting from scratch.
+ */
+void TemporalVoter::endFrame() {
+    frame++;
+    for (auto it = tracks.begin(); it != tracks.end();) {
+        if (frame - it->second.lastFrame > kTrackIdleFrames) {
+            it = tracks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/// @brief Set the distance that counts as half a Sequential vote to the threshold of the recognizer voted with
+/**
+ * @param distance The recognizer's accept threshold, LbphGallery::acceptThreshold(); ignored unless it is a finite
+ *                 positive distance.
+ *
+ * A compact gallery measures smaller distances than the model it was built from, so the weights are only
+ * comparable to the threshold when both are on the gallery's scale.
+ */
+void TemporalVoter::setReferenceDistance(double distance) {
+    if (distance > 0.0 && distance < DBL_MAX) {
+        rule.referenceDistance = distance;
+    }
+}
+
+/// @brief Discard the votes of all tracks and the names of their labels
+/**
+ * Call when the recognizer is replaced, since the labels of the new model may belong to other people.
+ */
+void TemporalVoter::reset() {
+    tracks.clear();
+    names.clear();
+}
+
+/// @brief Fill a decision with a label, its vote count and its name
+void TemporalVoter::describe(int trackId, int label, int count, VoteDecision& decision) const {
+    decision.trackId = trackId;
+    decision.label = label;
+    decision.count = count;
+    auto name = names.find(decision.label);
+    decision.name = name != names.end() ? name->second : "Unknown";
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+/// @brief The outcome of one voting round
+struct VoteDecision {
+    std::string name = "Unknown";  ///< Most frequent name in the round
+    int count = 0;                 ///< Number of votes the name received
+    int label = -1;                ///< Label of the name, -1 for "Unknown"
+    int trackId = 0;               ///< Track of the face that was voted on
+};
+
+
+/// @brief How a TemporalVoter turns votes into decisions
+enum class VoteMode {
+    Rounds,    ///< A decision every windowSize votes of a track, after which its window starts over
+    Sliding,   ///< A decision once a track's window is full and again whenever its leader changes
+    Sequential ///< A decision as soon as one label's evidence leads the runner-up by a margin, at most windowSize
+               ///< votes after the track's previous decision; repeated only for a different label
+};
+
+
+/// @brief When a Sequential vote has seen enough evidence
+/**
+ * Each vote adds referenceDistance / (referenceDistance + distance) to its label's evidence, from 1 for a perfect
+ * match through 0.5 at the reference distance. A rejected face adds rejectionWeight to the evidence of "Unknown"
+ * (label -1), so rejections hold back an early decision for someone else and can decide "Unknown" themselves. A label
+ * is decided once it has at least minVotes votes behind the round and its evidence exceeds the runner-up's by
+ * margin. A round that never gets there is decided by plain majority after windowSize votes, like Rounds mode.
+ */
+struct SequentialRule {
+    double margin = 4.0;              ///< Evidence lead over the runner-up needed to decide early
+    std::size_t minVotes = 5;         ///< Votes a round needs before it can be decided early
+    double referenceDistance = 100.0; ///< LBPH distance that counts as half a vote, the recognizer's threshold,
+                                      ///< see TemporalVoter::setReferenceDistance()
+    double rejectionWeight = 1.0;     ///< Evidence a rejected face adds to "Unknown", as much as a perfect match
+};
+
+
+/// @brief The last N labels voted for one face and how often each occurs among them.
+/**
+ * The labels are kept in a ring, and the counts in a table that is updated as each vote enters and the oldest one
+ * leaves. Labels with the same count are kept in a list per count, so the label with the most votes is known after
+ * every vote without scanning the window. Adding a vote and reading the leader are O(1).
+ *
+ * Ties go to the label that reached the count first, so a leader keeps its lead until another label has strictly
+ * more votes.
+ */
+class LabelWindow {
+public:
+    /// @brief Constructor sets the number of votes the window holds
+    explicit LabelWindow(std::size_t size = 60);
+
+    /// @brief Add a vote, evicting the oldest one once the window is full
+    /**
+     * @param label Voted label, -1 or greater.
+     */
+    void add(int label);
+
+    /// @brief Label with the most votes in the window, -1 if the window is empty
+    int leader() const;
+
+    /// @brief Number of votes the leader has in the window
+    int leaderCount() const;
+
+    /// @brief Number of votes for a label in the window
+    int count(int label) const;
+
+    /// @brief Number of votes in the window
+    std::size_t votes() const;
+
+    /// @brief Whether the window holds its full number of votes
+    bool full() const;
+
+    /// @brief Discard all votes
+    void clear();
+
+private:
+    void increment(int slot);
+    void decrement(int slot);
+    void unlink(int slot);
+    void pushFront(int slot);
+    void pushBack(int slot);
+
+    std::vector<int> ring;         ///< Slot (label + 1) of every vote; the oldest is at next once full
+    std::size_t next = 0;
+    std::size_t filled = 0;
+    std::vector<int> counts;       ///< Votes per slot in the window
+    std::vector<int> previous;     ///< Neighbours of each slot in the list of its count, -1 at the ends
+    std::vector<int> following;
+    std::vector<int> bucketHead;   ///< First and last slot with each count, -1 if none
+    std::vector<int> bucketTail;
+    int maxCount = 0;
+};
+
+
+/// @brief Smooths per-frame predictions into decisions by voting over each tracked face's recent predictions.
+/**
+ * Every accepted prediction is added as a vote for the face's track, so two people in front of the camera are
+ * voted on separately. Each track keeps a LabelWindow of its last windowSize labels; the current leader of a track
+ * is available after every vote. In Sequential mode (the default) a decision is made as soon as the LBPH distances of
+ * a track's votes favor one label clearly enough (see SequentialRule), with windowSize votes only as the upper bound,
+ * so a clearly recognized face unlocks after a fraction of the window. In Sliding mode a track's decision is made as
+ * soon as its window is full and made again whenever its leader changes; in Rounds mode a decision is made every
+ * windowSize votes and the window starts over, as the original 60-vote rounds did.
+ * Names are only stored once per label.
+ *
+ * This is the voting used by both the GUI and the headless daemon, so a decision means the same thing everywhere.
+ *
+ * @file TemporalVoter.h
+ */
+class TemporalVoter {
+public:
+    /// @brief Constructor sets the number of votes in one window and when decisions are made
+    /**
+     * @param windowSize Number of accepted predictions per track a decision is based on.
+     * @param mode When decisions are made, see VoteMode.
+     * @param rule When a Sequential vote decides early.
+     */
+    explicit TemporalVoter(std::size_t windowSize = 60, VoteMode mode = VoteMode::Sequential,
+                           const SequentialRule& rule = SequentialRule());
+
+    /// @brief Add one vote and report whether it produced a decision
+    /**
+     * @param trackId Track of the face, see FaceMatch::trackId.
+     * @param label Label predicted for the face.
+     * @param distance LBPH distance of the prediction, DBL_MAX if the face was rejected.
+     * @param name Name of the label; the latest name given for a label is the one decisions report.
+     * @param decision Receives the decision when the call returns true.
+     * @return true if a decision was made.
+     */
+    bool addVote(int trackId, int label, double distance, const std::string& name, VoteDecision& decision);
+
+    /// @brief The current leader of a track, in O(1)
+    /**
+     * @param trackId Track of the face.
+     * @param current Receives the label with the most votes in the track's window and its count.
+     * @return true if the track has votes, false otherwise.
+     */
+    bool leader(int trackId, VoteDecision& current) const;
+
+    /// @brief Mark the end of a frame, forgetting tracks that have not been voted for in a while
+    /**
+     * Call once per processed frame, after its votes.
+     */
+    void endFrame();
+
+    /// @brief Set the distance that counts as half a Sequential vote to the threshold of the recognizer voted with
+    /**
+     * @param distance The recognizer's accept threshold, LbphGallery::acceptThreshold(); ignored unless it is a
+     *                 finite positive distance.
+     */
+    void setReferenceDistance(double distance);
+
+    /// @brief Discard the votes of all tracks and the names of their labels
+    /**
+     * Call when the recognizer is replaced, since the labels of the new model may belong to other people.
+     */
+    void reset();
+
+private:
+    struct TrackVotes {
+        LabelWindow window;
+        std::size_t sinceDecision = 0;   ///< Votes since the last decision (Rounds and Sequential modes)
+        int decided = -2;                ///< Label of the last decision, -2 before the first (Sliding and Sequential)
+        std::size_t lastFrame = 0;       ///< Frame of the last vote
+        std::vector<std::pair<int, double>> evidence{};   ///< Evidence per label since the last decision (Sequential)
+    };
+
+    bool decideSequential(TrackVotes& track, int label, double distance, int& decided) const;
+    void describe(int trackId, int label, int count, VoteDecision& decision) const;
+
+    std::size_t windowSize;
+    VoteMode mode;
+    SequentialRule rule;
+    std::size_t frame = 0;
+    std::unordered_map<int, TrackVotes> tracks;
+    std::unordered_map<int, std::string> names;   ///< Latest name of every label voted for
+};
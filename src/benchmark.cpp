@@ -0,0 +1,939 @@
+/**
+ * @file benchmark.cpp
+ * @brief Repeatable performance measurements on recorded input.
+ *
+ * Every benchmark reads frames from a FrameSource, so two builds can be compared on exactly the same recording.
+ *
+ * replay: runs the full recognition pipeline and the 60-vote decision on a video file or image directory and
+ * reports throughput, per-frame latency and decision latency. With --mode fast every frame is processed exactly once
+ * as quickly as the pipeline allows (throughput runs); with --mode realtime frames arrive at their original
+ * timestamps and are dropped if the pipeline lags, like a live camera (latency runs). --detect-every N sets how often
+ * the face detector runs, with faces tracked in between, so detector savings can be measured against N = 1;
+ * --no-gate processes every frame even when the scene is static; --decimate 1|2|4 fixes the factor the detector shrinks
+ * frames by instead of deriving it from the minimum face size; --vote rounds|sliding|sequential picks the voting mode
+ * (sequential early decisions by default, a per-track sliding window, or the original rounds of 60 votes). Live
+ * cameras are refused, since a replay has to end.
+ *
+ * decide: runs the recognition pipeline over a recording once, keeps every accepted prediction, and replays the same
+ * votes through each voting mode. For each mode it reports how many tracks were decided, the time to each track's
+ * first decision in recording time and in votes, and the error rate: the share of first decisions that differ from
+ * --expect NAME when the recording shows one known person, or else from the track's full 60-vote majority. A
+ * recording of someone who is not enrolled is checked with --expect Unknown, where every decision for a name is an
+ * impostor let in. --margin M, --min-votes N and --reject-weight W tune the sequential rule, see SequentialRule;
+ * --reject-weight 0 gives the rule without evidence from rejected faces for comparison.
+ *
+ * detect: runs full-frame detection alone over the first --frames N frames of the source, once per thread count in
+ * --threads, and reports the time per frame, the speedup over one thread and how many boxes agree with the serial
+ * scan (overlap of at least 0.5), so the tile-parallel scan can be checked for both scaling and correctness.
+ *
+ * predict: crops the faces detected in the first --frames N frames and predicts each of them with OpenCV's LBPH
+ * predict and with the LbphGallery, reporting the time per prediction, the speedup and whether labels and
+ * distances agree. It also predicts the faces in groups of --batch N with predictBatch(), as a frame with N people
+ * would be, and reports the time per face and whether the labels match one-by-one prediction.
+ *
+ * gallery: builds the gallery from embeddings.xml in every storage format (full or uniform-pattern bins; float,
+ * 16-bit or 8-bit) and reports its size in memory and on disk, load time, predict time and how many labels agree
+ * with OpenCV's predict, on the faces detected in the first --frames N frames.
+ *
+ * startup: opens the recognizer --repeat N times from embeddings.xml (parsed by cv::FileStorage) and from
+ * gallery.bin (mapped), and reports the time to open and to the first prediction for each.
+ *
+ * concurrent: predicts the faces detected in the first --frames N frames from 1, 2, 4, ... threads at once on one
+ * shared recognizer for --seconds S per thread count, while another thread keeps reloading gallery.bin into it. It
+ * reports predictions per second and the speedup over one thread, and fails if any prediction differs from a serial
+ * run, so it doubles as a stress test of lock-free concurrent predict.
+ *
+ * Usage: OpenCVProjectBench replay --source SPEC [--mode fast|realtime] [--render] [--detect-every N] [--no-gate]
+ *                                  [--decimate F] [--vote rounds|sliding|sequential]
+ *        OpenCVProjectBench decide --source SPEC [--expect NAME] [--margin M] [--min-votes N]
+ *        OpenCVProjectBench detect --source SPEC [--threads 1,2,4,8] [--frames N] [--decimate F]
+ *        OpenCVProjectBench predict --source SPEC [--frames N] [--batch N]
+ *        OpenCVProjectBench gallery --source SPEC [--frames N]
+ *        OpenCVProjectBench startup [--repeat N]
+ *        OpenCVProjectBench concurrent --source SPEC [--threads 1,2,4,8] [--frames N] [--seconds S]
+ */
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FaceDetector.h"
+#include "FacePreprocessor.h"
+#include "FaceRecognizerWrapper.h"
+#include "FrameGrabber.h"
+#include "RecognitionPipeline.h"
+#include "TemporalVoter.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Milliseconds between two time points
+double elapsedMs(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+/// Print count, mean, median, 95th percentile and maximum of a set of millisecond samples
+void printLatency(const std::string& label, std::vector<double> samples) {
+    std::cout << std::left << std::setw(20) << label;
+    if (samples.empty()) {
+        std::cout << "no samples" << std::endl;
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    auto percentile = [&samples](double p) {
+        return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * static_cast<double>(samples.size())))];
+    };
+    std::cout << std::fixed << std::setprecision(2) << "n=" << samples.size() << " mean=" << sum / samples.size()
+              << "ms p50=" << percentile(0.50) << "ms p95=" << percentile(0.95) << "ms max=" << samples.back()
+              << "ms" << std::endl;
+}
+
+/// One decision made during a replay, kept so runs can be compared decision by decision
+struct ReplayDecision {
+    std::string name;
+    int trackId = 0;
+    int votes = 0;
+    double sourceTimeMs = 0.0;   ///< Recording time of the frame that completed the vote
+    double latencyMs = 0.0;      ///< Wall time from capture of the track's first vote since its last decision
+};
+
+/**
+ * @brief Replays a recording through the recognition pipeline and the temporal voter
+ *
+ * @param sourceSpec Video file or image directory to replay.
+ * @param mode Pacing of the replay.
+ * @param render Whether the render stage draws overlays, as the GUI does.
+ * @param detectInterval Run the detector on one frame out of this many.
+ * @param motionGate Whether frames of a static scene skip detection and recognition.
+ * @param voteMode When the voter makes decisions.
+ * @param decimation Factor the detector shrinks frames by, 0 to derive it from the minimum face size.
+ * @return int 0 upon success, -1 if the source could not be opened or is a live camera.
+ */
+int runReplay(const std::string& sourceSpec, ReplayMode mode, bool render, int detectInterval, bool motionGate,
+              int decimation, VoteMode voteMode) {
+    std::string root = PROJECT_ROOT_DIR;
+    FaceDetector detector;
+    detector.loadConfig(root + "/textfiles/detector.yml", root);
+    DetectionParams params = detector.params();
+    params.decimation = decimation;
+    detector.setParams(params);
+    auto faceRec = std::make_shared<FaceRecognizerWrapper>(1, 10, 8, 8, 100.0);
+    if (!faceRec->loadGallery(root + "/recognizer/gallery.bin")) {
+        faceRec->loadModel(root + "/recognizer/embeddings.xml");
+    }
+    faceRec->loadLabels(root + "/recognizer/labels.txt");
+
+    auto source = FrameSource::create(sourceSpec);
+    if (source->isLive()) {
+        // A camera never runs out of frames, so the replay would never finish and its results would not be repeatable
+        std::cerr << "Error: " << source->description() << " is live, replay needs a video file or image directory"
+                  << std::endl;
+        return -1;
+    }
+
+    RecognitionPipeline pipeline(detector, faceRec);
+    pipeline.setRenderEnabled(render);
+    pipeline.setDetectInterval(detectInterval);
+    pipeline.setMotionGateEnabled(motionGate);
+    pipeline.setPreprocessParams(loadPreprocessConfig(root + "/textfiles/preprocess.yml"));
+
+    std::mutex statsMutex;
+    std::vector<double> frameLatencies;
+    std::vector<ReplayDecision> decisions;
+    std::size_t faceCount = 0;
+    TemporalVoter voter(60, voteMode);
+    voter.setReferenceDistance(faceRec->getGallery()->acceptThreshold());
+    std::map<int, Clock::time_point> roundStart;   ///< Capture time of each track's first vote since its decision
+    Clock::time_point lastResult;
+
+    pipeline.setResultCallback([&](FrameResult&& result) {
+        Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(statsMutex);
+        lastResult = now;
+        frameLatencies.push_back(elapsedMs(result.frame.timestamp, now));
+        faceCount += result.faces.size();
+        for (const auto& face : result.faces) {
+            if (!face.accepted) {
+                continue;
+            }
+            roundStart.emplace(face.trackId, result.frame.timestamp);
+            VoteDecision decision;
+            if (voter.addVote(face.trackId, face.label, face.confidence, face.name, decision)) {
+                decisions.push_back({decision.name, decision.trackId, decision.count, result.frame.sourceTimeMs,
+                                     elapsedMs(roundStart[face.trackId], now)});
+                roundStart.erase(face.trackId);
+            }
+        }
+        voter.endFrame();
+    });
+
+    FrameGrabber grabber;
+    Clock::time_point start = Clock::now();
+    if (!grabber.start(std::move(source), mode)) {
+        return -1;
+    }
+    pipeline.start(grabber.frames());
+    while (!pipeline.isFinished()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    pipeline.stop();
+    grabber.stop();
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    double wallMs = elapsedMs(start, frameLatencies.empty() ? Clock::now() : lastResult);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "source              " << sourceSpec << std::endl;
+    std::cout << "mode                " << (mode == ReplayMode::AsFastAsPossible ? "fast" : "realtime")
+              << (render ? ", render on" : ", render off") << std::endl;
+    std::cout << "frames processed    " << frameLatencies.size() << std::endl;
+    std::cout << "frames dropped      " << grabber.frames().droppedCount() << std::endl;
+    std::cout << "detector backend    " << detector.backendName() << std::endl;
+    std::cout << "detect interval     " << detectInterval << ", decimation 1/" << detector.decimation() << std::endl;
+    std::cout << "idle frames         " << pipeline.idleFrames() << (motionGate ? "" : " (motion gate off)") << std::endl;
+    std::cout << "detector runs       " << pipeline.detectorRuns() << " (" << pipeline.fullScanRuns() << " full frame)"
+              << std::endl;
+    std::cout << "faces reported      " << faceCount << std::endl;
+    std::cout << "wall time           " << wallMs / 1000.0 << "s" << std::endl;
+    std::cout << "throughput          " << (wallMs > 0.0 ? frameLatencies.size() * 1000.0 / wallMs : 0.0) << " fps"
+              << std::endl;
+    printLatency("frame latency", frameLatencies);
+
+    std::vector<double> decisionLatencies;
+    for (const auto& decision : decisions) {
+        decisionLatencies.push_back(decision.latencyMs);
+    }
+    printLatency("decision latency", decisionLatencies);
+    for (const auto& decision : decisions) {
+        std::cout << "  decision at " << decision.sourceTimeMs << "ms: " << decision.name << " (track "
+                  << decision.trackId << ", " << decision.votes << " votes)" << std::endl;
+    }
+    return 0;
+}
+
+/// One accepted prediction of a replayed recording
+struct RecordedVote {
+    int trackId = 0;
+    int label = -1;
+    double distance = 0.0;
+    std::string name;
+};
+
+/// The accepted predictions of one processed frame
+struct RecordedFrame {
+    double sourceTimeMs = 0.0;
+    std::vector<RecordedVote> votes;
+};
+
+/// First decision of one track in a simulated vote
+struct TrackDecision {
+    std::string name;
+    double timeMs = 0.0;   ///< Recording time from the track's first vote to the decision
+    int votes = 0;         ///< Votes the track had cast by the decision
+};
+
+/// Run a recording through the pipeline once as fast as possible and keep the accepted predictions of every frame,
+/// along with the recognizer's accept threshold the votes are weighed against
+bool recordVotes(const std::string& sourceSpec, std::vector<RecordedFrame>& frames, double& threshold) {
+    std::string root = PROJECT_ROOT_DIR;
+    FaceDetector detector;
+    detector.loadConfig(root + "/textfiles/detector.yml", root);
+    auto faceRec = std::make_shared<FaceRecognizerWrapper>(1, 10, 8, 8, 100.0);
+    if (!faceRec->loadGallery(root + "/recognizer/gallery.bin")) {
+        faceRec->loadModel(root + "/recognizer/embeddings.xml");
+    }
+    faceRec->loadLabels(root + "/recognizer/labels.txt");
+    threshold = faceRec->getGallery()->acceptThreshold();
+
+    RecognitionPipeline pipeline(detector, faceRec);
+    pipeline.setRenderEnabled(false);
+    pipeline.setPreprocessParams(loadPreprocessConfig(root + "/textfiles/preprocess.yml"));
+
+    std::mutex framesMutex;
+    pipeline.setResultCallback([&](FrameResult&& result) {
+        RecordedFrame recorded;
+        recorded.sourceTimeMs = result.frame.sourceTimeMs;
+        for (const auto& face : result.faces) {
+            if (face.accepted) {
+                recorded.votes.push_back({face.trackId, face.label, face.confidence, face.name});
+            }
+        }
+        std::lock_guard<std::mutex> lock(framesMutex);
+        frames.push_back(std::move(recorded));
+    });
+
+    auto source = FrameSource::create(sourceSpec);
+    if (source->isLive()) {
+        std::cerr << "Error: " << source->description() << " is live, decide needs a video file or image directory"
+                  << std::endl;
+        return false;
+    }
+    FrameGrabber grabber;
+    if (!grabber.start(std::move(source), ReplayMode::AsFastAsPossible)) {
+        return false;
+    }
+    pipeline.start(grabber.frames());
+    while (!pipeline.isFinished()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    pipeline.stop();
+    grabber.stop();
+    return true;
+}
+
+/// Replay recorded votes through a voter and return the first decision of every track that got one
+std::map<int, TrackDecision> simulateVote(const std::vector<RecordedFrame>& frames, VoteMode mode,
+                                          const SequentialRule& rule) {
+    TemporalVoter voter(60, mode, rule);
+    std::map<int, TrackDecision> decided;
+    std::map<int, std::pair<double, int>> seen;   ///< Time of each track's first vote and its votes so far
+    for (const auto& frame : frames) {
+        for (const auto& vote : frame.votes) {
+            auto& track = seen.emplace(vote.trackId, std::make_pair(frame.sourceTimeMs, 0)).first->second;
+            track.second++;
+            VoteDecision decision;
+            if (voter.addVote(vote.trackId, vote.label, vote.distance, vote.name, decision) &&
+                decided.find(vote.trackId) == decided.end()) {
+                decided[vote.trackId] = {decision.name, frame.sourceTimeMs - track.first, track.second};
+            }
+        }
+        voter.endFrame();
+    }
+    return decided;
+}
+
+/**
+ * @brief Compares the voting modes on the same recorded predictions
+ *
+ * @param sourceSpec Video file or image directory to replay.
+ * @param expected Name of the one person shown in the recording, empty to compare against the 60-vote majority.
+ * @param rule Sequential decision rule; its reference distance is taken from the gallery's accept threshold.
+ * @return int 0 upon success, -1 if the source could not be opened.
+ */
+int runDecide(const std::string& sourceSpec, const std::string& expected, SequentialRule rule) {
+    std::vector<RecordedFrame> frames;
+    double threshold = DBL_MAX;
+    if (!recordVotes(sourceSpec, frames, threshold)) {
+        return -1;
+    }
+    // Votes are weighed against the threshold of the gallery they were predicted with, as in the GUI and daemon
+    if (threshold > 0.0 && threshold < DBL_MAX) {
+        rule.referenceDistance = threshold;
+    }
+    std::size_t voteCount = 0;
+    for (const auto& frame : frames) {
+        voteCount += frame.votes.size();
+    }
+    std::map<int, TrackDecision> majority = simulateVote(frames, VoteMode::Rounds, rule);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "source              " << sourceSpec << std::endl;
+    std::cout << "frames processed    " << frames.size() << std::endl;
+    std::cout << "accepted votes      " << voteCount << std::endl;
+    std::cout << "reference           " << (expected.empty() ? "60-vote majority of each track" : expected)
+              << std::endl;
+    std::cout << "sequential rule     margin " << rule.margin << ", min votes " << rule.minVotes
+              << ", rejection weight " << rule.rejectionWeight << ", reference distance " << rule.referenceDistance
+              << std::endl;
+
+    const std::pair<const char*, VoteMode> modes[] = {
+        {"rounds", VoteMode::Rounds}, {"sliding", VoteMode::Sliding}, {"sequential", VoteMode::Sequential}};
+    for (const auto& mode : modes) {
+        std::map<int, TrackDecision> decided = simulateVote(frames, mode.second, rule);
+        std::vector<double> times;
+        std::vector<double> votes;
+        int compared = 0;
+        int wrong = 0;
+        for (const auto& entry : decided) {
+            times.push_back(entry.second.timeMs);
+            votes.push_back(entry.second.votes);
+            std::string reference = expected;
+            if (reference.empty()) {
+                auto found = majority.find(entry.first);
+                if (found == majority.end()) {
+                    continue;
+                }
+                reference = found->second.name;
+            }
+            compared++;
+            wrong += entry.second.name != reference ? 1 : 0;
+        }
+        std::cout << mode.first << ": " << decided.size() << " tracks decided, " << wrong << " of " << compared
+                  << " wrong (" << (compared > 0 ? 100.0 * wrong / compared : 0.0) << "% error)" << std::endl;
+        printLatency("  time to decide", times);
+        std::sort(votes.begin(), votes.end());
+        if (!votes.empty()) {
+            std::cout << "  votes to decide   p50=" << votes[votes.size() / 2] << " max=" << votes.back()
+                      << std::endl;
+        }
+    }
+    return 0;
+}
+
+/// Read up to maxFrames frames from a source as grayscale images
+std::vector<cv::Mat> readGrayFrames(const std::string& sourceSpec, int maxFrames) {
+    std::vector<cv::Mat> frames;
+    auto source = FrameSource::create(sourceSpec);
+    if (!source->open()) {
+        return frames;
+    }
+    cv::Mat frame;
+    double timestampMs = 0.0;
+    while (static_cast<int>(frames.size()) < maxFrames && source->read(frame, timestampMs)) {
+        cv::Mat gray;
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        frames.push_back(gray);
+    }
+    source->close();
+    if (frames.empty()) {
+        std::cerr << "Error: No frames read from " << source->description() << std::endl;
+    }
+    return frames;
+}
+
+/// Intersection over union of two boxes
+double overlap(const cv::Rect& a, const cv::Rect& b) {
+    double intersection = (a & b).area();
+    double unionArea = a.area() + b.area() - intersection;
+    return unionArea > 0.0 ? intersection / unionArea : 0.0;
+}
+
+/**
+ * @brief Times full-frame detection at several thread counts and compares the boxes with a serial scan
+ *
+ * @param sourceSpec Video file or image directory to read frames from.
+ * @param threadCounts Thread counts to measure; 1 is always measured first as the reference.
+ * @param maxFrames Number of frames to read from the source.
+ * @param decimation Factor the detector shrinks frames by, 0 to derive it from the minimum face size.
+ * @return int 0 upon success, -1 if no frame could be read.
+ */
+int runDetect(const std::string& sourceSpec, std::vector<int> threadCounts, int maxFrames, int decimation) {
+    std::string root = PROJECT_ROOT_DIR;
+    FaceDetector detector;
+    detector.loadConfig(root + "/textfiles/detector.yml", root);
+    DetectionParams params = detector.params();
+    params.decimation = decimation;
+
+    std::vector<cv::Mat> frames = readGrayFrames(sourceSpec, maxFrames);
+    if (frames.empty()) {
+        return -1;
+    }
+
+    threadCounts.erase(std::remove(threadCounts.begin(), threadCounts.end(), 1), threadCounts.end());
+    threadCounts.insert(threadCounts.begin(), 1);
+
+    std::cout << "source              " << sourceSpec << " (" << frames.size() << " frames)" << std::endl;
+    std::cout << "detector backend    " << detector.backendName() << ", decimation 1/" << detector.decimation()
+              << std::endl;
+    std::cout << "threads  ms/frame  speedup  boxes  agree" << std::endl;
+
+    std::vector<std::vector<cv::Rect>> serial;
+    double serialMs = 0.0;
+    for (int threads : threadCounts) {
+        params.threads = threads;
+        detector.setParams(params);
+        // Warm up so worker backends are loaded and buffers allocated before timing
+        detector.detectFaces(frames.front());
+
+        std::vector<std::vector<cv::Rect>> boxes;
+        Clock::time_point start = Clock::now();
+        for (const auto& gray : frames) {
+            boxes.push_back(detector.detectFaces(gray));
+        }
+        double msPerFrame = elapsedMs(start, Clock::now()) / frames.size();
+        if (threads == 1) {
+            serial = boxes;
+            serialMs = msPerFrame;
+        }
+
+        std::size_t total = 0, agreeing = 0, serialTotal = 0;
+        for (std::size_t i = 0; i < frames.size(); i++) {
+            total += boxes[i].size();
+            serialTotal += serial[i].size();
+            for (const auto& box : serial[i]) {
+                if (std::any_of(boxes[i].begin(), boxes[i].end(),
+                                [&box](const cv::Rect& other) { return overlap(box, other) >= 0.5; })) {
+                    agreeing++;
+                }
+            }
+        }
+        std::cout << std::fixed << std::setprecision(2) << std::right << std::setw(7) << threads << std::setw(10)
+                  << msPerFrame << std::setw(8) << (msPerFrame > 0.0 ? serialMs / msPerFrame : 0.0) << "x"
+                  << std::setw(7) << total << std::setw(6) << agreeing << "/" << serialTotal << std::endl;
+    }
+    return 0;
+}
+
+/// Crop the faces the configured detector finds in the first maxFrames frames of a source, preprocessed as the
+/// pipeline preprocesses them
+std::vector<cv::Mat> collectFaces(const std::string& sourceSpec, int maxFrames) {
+    std::string root = PROJECT_ROOT_DIR;
+    FaceDetector detector;
+    detector.loadConfig(root + "/textfiles/detector.yml", root);
+    FacePreprocessor preprocessor(loadPreprocessConfig(root + "/textfiles/preprocess.yml"));
+    std::vector<cv::Mat> faces;
+    for (const auto& gray : readGrayFrames(sourceSpec, maxFrames)) {
+        for (const auto& rect : detector.detectFaces(gray)) {
+            cv::Mat face;
+            preprocessor.apply(gray(rect), face);
+            faces.push_back(face);
+        }
+    }
+    if (faces.empty()) {
+        std::cerr << "Error: No faces found in " << sourceSpec << std::endl;
+    }
+    return faces;
+}
+
+/**
+ * @brief Compares OpenCV's LBPH predict with the LbphGallery on the faces of a recording
+ *
+ * @param sourceSpec Video file or image directory to read frames from.
+ * @param maxFrames Number of frames to read from the source.
+ * @param batchSize Number of faces passed to each predictBatch() call.
+ * @return int 0 upon success, -1 if no frame, face or model could be loaded.
+ */
+int runPredict(const std::string& sourceSpec, int maxFrames, int batchSize) {
+    std::string root = PROJECT_ROOT_DIR;
+    FaceRecognizerWrapper faceRec(1, 10, 8, 8, 100.0);
+    faceRec.loadModel(root + "/recognizer/embeddings.xml");
+    if (faceRec.getGallery()->empty()) {
+        std::cerr << "Error: No trained model in " << root << "/recognizer" << std::endl;
+        return -1;
+    }
+    std::vector<cv::Mat> faces = collectFaces(sourceSpec, maxFrames);
+    if (faces.empty()) {
+        return -1;
+    }
+
+    struct Prediction {
+        int label = -1;
+        double distance = 0.0;
+    };
+    auto timePredictions = [&](bool gallery, std::vector<Prediction>& predictions) {
+        faceRec.setGalleryEnabled(gallery);
+        predictions.assign(faces.size(), Prediction());
+        Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < faces.size(); i++) {
+            predictions[i].label = faceRec.predict(faces[i], predictions[i].distance);
+        }
+        return elapsedMs(start, Clock::now()) * 1000.0 / faces.size();
+    };
+    std::vector<Prediction> reference, fast;
+    double referenceUs = timePredictions(false, reference);
+    double fastUs = timePredictions(true, fast);
+
+    // The same faces in groups of batchSize, as the pipeline passes the faces of one frame
+    std::vector<int> batchLabels;
+    std::vector<double> batchDistances;
+    std::size_t sameBatchLabel = 0;
+    Clock::time_point batchStart = Clock::now();
+    for (std::size_t first = 0; first < faces.size(); first += batchSize) {
+        std::vector<cv::Mat> batch(faces.begin() + first,
+                                   faces.begin() + std::min(faces.size(), first + batchSize));
+        faceRec.predictBatch(batch, batchLabels, batchDistances);
+        for (std::size_t i = 0; i < batch.size(); i++) {
+            if (batchLabels[i] == fast[first + i].label) {
+                sameBatchLabel++;
+            }
+        }
+    }
+    double batchUs = elapsedMs(batchStart, Clock::now()) * 1000.0 / faces.size();
+
+    std::size_t sameLabel = 0;
+    double maxDifference = 0.0;
+    for (std::size_t i = 0; i < faces.size(); i++) {
+        if (reference[i].label == fast[i].label) {
+            sameLabel++;
+        }
+        if (reference[i].label != -1 && fast[i].label != -1) {
+            maxDifference = std::max(maxDifference, std::fabs(reference[i].distance - fast[i].distance));
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "source              " << sourceSpec << " (" << faces.size() << " faces)" << std::endl;
+    std::cout << "gallery             " << faceRec.getGallery()->size() << " images, " << LbphGallery::kernelName()
+              << " kernel" << std::endl;
+    std::cout << "opencv predict      " << referenceUs << "us/face" << std::endl;
+    std::cout << "gallery predict     " << fastUs << "us/face (" << (fastUs > 0.0 ? referenceUs / fastUs : 0.0)
+              << "x)" << std::endl;
+    std::cout << "batch predict       " << batchUs << "us/face in batches of " << batchSize << " ("
+              << (batchUs > 0.0 ? fastUs / batchUs : 0.0) << "x over gallery predict)" << std::endl;
+    std::cout << "same label          " << sameLabel << "/" << faces.size() << std::endl;
+    std::cout << "same batch label    " << sameBatchLabel << "/" << faces.size() << std::endl;
+    std::cout << "max distance diff   " << std::scientific << maxDifference << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Compares the gallery storage formats with the OpenCV model on the faces of a recording
+ *
+ * @param sourceSpec Video file or image directory to read frames from.
+ * @param maxFrames Number of frames to read from the source.
+ * @return int 0 upon success, -1 if no frame, face or model could be loaded.
+ */
+int runGallery(const std::string& sourceSpec, int maxFrames) {
+    std::string root = PROJECT_ROOT_DIR;
+    std::string modelPath = root + "/recognizer/embeddings.xml";
+    cv::Ptr<cv::face::LBPHFaceRecognizer> model = cv::face::LBPHFaceRecognizer::create(1, 10, 8, 8, 100.0);
+    Clock::time_point start = Clock::now();
+    try {
+        model->read(modelPath);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error loading model: " << e.what() << std::endl;
+        return -1;
+    }
+    double modelLoadMs = elapsedMs(start, Clock::now());
+    std::vector<cv::Mat> faces = collectFaces(sourceSpec, maxFrames);
+    if (faces.empty()) {
+        return -1;
+    }
+
+    std::vector<int> reference(faces.size());
+    start = Clock::now();
+    for (std::size_t i = 0; i < faces.size(); i++) {
+        double distance = 0.0;
+        model->predict(faces[i], reference[i], distance);
+    }
+    double modelPredictUs = elapsedMs(start, Clock::now()) * 1000.0 / faces.size();
+
+    std::error_code error;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "source              " << sourceSpec << " (" << faces.size() << " faces), "
+              << LbphGallery::kernelName() << " kernel" << std::endl;
+    std::cout << "format            memory MB   file MB   load ms   us/face  same label" << std::endl;
+    std::cout << std::left << std::setw(18) << "opencv model" << std::right << std::setw(10) << "-" << std::setw(10)
+              << fs::file_size(modelPath, error) / 1e6 << std::setw(10) << modelLoadMs << std::setw(10)
+              << modelPredictUs << std::setw(12) << "-" << std::endl;
+
+    std::string path = (fs::temp_directory_path(error) / "OpenCVProjectBench-gallery.bin").string();
+    for (const GalleryFormat& format : {GalleryFormat{false, 32}, GalleryFormat{false, 16}, GalleryFormat{true, 32},
+                                        GalleryFormat{true, 16}, GalleryFormat{true, 8}}) {
+        LbphGallery built;
+        if (!built.build(*model, format) || !built.write(path)) {
+            return -1;
+        }
+        LbphGallery gallery;
+        start = Clock::now();
+        if (!gallery.read(path)) {
+            return -1;
+        }
+        double loadMs = elapsedMs(start, Clock::now());
+
+        std::size_t sameLabel = 0;
+        start = Clock::now();
+        for (std::size_t i = 0; i < faces.size(); i++) {
+            double distance = 0.0;
+            if (gallery.predict(faces[i], distance) == reference[i]) {
+                sameLabel++;
+            }
+        }
+        double predictUs = elapsedMs(start, Clock::now()) * 1000.0 / faces.size();
+
+        std::string name = std::string(format.uniform ? "uniform" : "full") + " " + std::to_string(format.bits) + "-bit";
+        std::cout << std::left << std::setw(18) << name << std::right << std::setw(10) << gallery.memoryBytes() / 1e6
+                  << std::setw(10) << fs::file_size(path, error) / 1e6 << std::setw(10) << loadMs << std::setw(10)
+                  << predictUs << std::setw(7) << sameLabel << "/" << faces.size() << std::endl;
+    }
+    fs::remove(path, error);
+    return 0;
+}
+
+/**
+ * @brief Measures how long the recognizer takes to open from the XML model and from the binary gallery
+ *
+ * The first runs include reading the files from disk unless they are already in the page cache; later runs show
+ * the cost with a warm cache, which for the mapped gallery is what every process after the first one pays.
+ *
+ * @param repeat Number of times each file is opened.
+ * @return int 0 upon success, -1 if the model could not be found.
+ */
+int runStartup(int repeat) {
+    std::string root = PROJECT_ROOT_DIR;
+    std::string modelPath = root + "/recognizer/embeddings.xml";
+    std::string galleryPath = root + "/recognizer/gallery.bin";
+    std::error_code error;
+    if (!fs::exists(modelPath)) {
+        std::cerr << "Error: No trained model at " << modelPath << std::endl;
+        return -1;
+    }
+    if (!fs::exists(galleryPath)) {
+        std::cerr << "Warning: No " << galleryPath << ", run OpenCVProjectTrain --convert " << modelPath << " "
+                  << galleryPath << " first to include it" << std::endl;
+    }
+
+    cv::Mat face(120, 120, CV_8U);
+    cv::randu(face, 0, 256);
+    std::vector<double> modelOpen, modelFirst, galleryOpen, galleryFirst;
+    for (int run = 0; run < repeat; run++) {
+        double confidence = 0.0;
+        {
+            FaceRecognizerWrapper faceRec(1, 10, 8, 8, 100.0);
+            Clock::time_point start = Clock::now();
+            faceRec.loadModel(modelPath);
+            Clock::time_point opened = Clock::now();
+            faceRec.predict(face, confidence);
+            modelOpen.push_back(elapsedMs(start, opened));
+            modelFirst.push_back(elapsedMs(start, Clock::now()));
+        }
+        FaceRecognizerWrapper faceRec(1, 10, 8, 8, 100.0);
+        Clock::time_point start = Clock::now();
+        if (!faceRec.loadGallery(galleryPath)) {
+            continue;
+        }
+        Clock::time_point opened = Clock::now();
+        faceRec.predict(face, confidence);
+        galleryOpen.push_back(elapsedMs(start, opened));
+        galleryFirst.push_back(elapsedMs(start, Clock::now()));
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "embeddings.xml      " << fs::file_size(modelPath, error) / 1e6 << " MB" << std::endl;
+    printLatency("  open", modelOpen);
+    printLatency("  first predict", modelFirst);
+    std::cout << "gallery.bin         " << (fs::exists(galleryPath) ? fs::file_size(galleryPath, error) / 1e6 : 0.0)
+              << " MB" << std::endl;
+    printLatency("  open", galleryOpen);
+    printLatency("  first predict", galleryFirst);
+    return 0;
+}
+
+/**
+ * @brief Predicts from several threads at once on one shared recognizer while its gallery is swapped
+ *
+ * @param sourceSpec Video file or image directory to read frames from.
+ * @param threadCounts Numbers of predicting threads to compare.
+ * @param maxFrames Number of frames to read from the source.
+ * @param seconds Time each thread count runs for.
+ * @return int 0 if every concurrent prediction matched the serial one, -1 otherwise or if nothing could be loaded.
+ */
+int runConcurrent(const std::string& sourceSpec, const std::vector<int>& threadCounts, int maxFrames, double seconds) {
+    std::string root = PROJECT_ROOT_DIR;
+    std::string galleryPath = root + "/recognizer/gallery.bin";
+    auto faceRec = std::make_shared<FaceRecognizerWrapper>(1, 10, 8, 8, 100.0);
+    bool swapping = faceRec->loadGallery(galleryPath);
+    if (!swapping) {
+        faceRec->loadModel(root + "/recognizer/embeddings.xml");
+        std::cerr << "Warning: No " << galleryPath << ", the gallery is not swapped during the run" << std::endl;
+    }
+    if (faceRec->getGallery()->empty()) {
+        std::cerr << "Error: No trained model in " << root << "/recognizer" << std::endl;
+        return -1;
+    }
+    std::vector<cv::Mat> faces = collectFaces(sourceSpec, maxFrames);
+    if (faces.empty()) {
+        return -1;
+    }
+
+    std::vector<int> referenceLabels(faces.size());
+    std::vector<double> referenceDistances(faces.size());
+    for (std::size_t i = 0; i < faces.size(); i++) {
+        referenceLabels[i] = faceRec->predict(faces[i], referenceDistances[i]);
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "source              " << sourceSpec << " (" << faces.size() << " faces, "
+              << faceRec->getGallery()->size() << " enrolled)" << std::endl;
+    std::cout << "threads   predictions/s   speedup   swaps   mismatches" << std::endl;
+    std::shared_ptr<const FaceRecognizerWrapper> shared = faceRec;
+    double baseline = 0.0;
+    bool consistent = true;
+    for (int threadCount : threadCounts) {
+        std::atomic<bool> stop{false};
+        std::atomic<std::size_t> predictions{0};
+        std::atomic<std::size_t> mismatches{0};
+        std::size_t swaps = 0;
+        std::vector<std::thread> workers;
+        Clock::time_point start = Clock::now();
+        for (int t = 0; t < threadCount; t++) {
+            workers.emplace_back([&, t]() {
+                std::size_t done = 0;
+                std::size_t wrong = 0;
+                // Each thread starts at a different face so the threads do not run in lockstep
+                for (std::size_t i = t * faces.size() / threadCount; !stop; i = (i + 1) % faces.size()) {
+                    double distance = 0.0;
+                    int label = shared->predict(faces[i], distance);
+                    if (label != referenceLabels[i] || distance != referenceDistances[i]) {
+                        wrong++;
+                    }
+                    done++;
+                }
+                predictions += done;
+                mismatches += wrong;
+            });
+        }
+        while (elapsedMs(start, Clock::now()) < seconds * 1000.0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            if (swapping && faceRec->loadGallery(galleryPath)) {
+                swaps++;
+            }
+        }
+        stop = true;
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        double rate = predictions / (elapsedMs(start, Clock::now()) / 1000.0);
+        if (baseline == 0.0) {
+            baseline = rate;
+        }
+        consistent = consistent && mismatches == 0;
+        std::cout << std::setw(7) << threadCount << std::setw(16) << rate << std::setw(9) << rate / baseline << "x"
+                  << std::setw(8) << swaps << std::setw(13) << mismatches << std::endl;
+    }
+    if (!consistent) {
+        std::cerr << "Error: Concurrent predictions differ from serial ones" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+/// Print the command-line usage
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program
+              << " replay --source SPEC [--mode fast|realtime] [--render] [--detect-every N] [--no-gate] [--decimate F]"
+              << " [--vote rounds|sliding|sequential]" << std::endl
+              << "       " << program << " decide --source SPEC [--expect NAME] [--margin M] [--min-votes N]"
+              << " [--reject-weight W]" << std::endl
+              << "       " << program << " detect --source SPEC [--threads 1,2,4,8] [--frames N] [--decimate F]"
+              << std::endl
+              << "       " << program << " predict --source SPEC [--frames N] [--batch N]" << std::endl
+              << "       " << program << " gallery --source SPEC [--frames N]" << std::endl
+              << "       " << program << " startup [--repeat N]" << std::endl
+              << "       " << program << " concurrent --source SPEC [--threads 1,2,4,8] [--frames N] [--seconds S]"
+              << std::endl;
+}
+
+}
+
+/**
+ * @brief Parses the command line and runs the selected benchmark
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The benchmark name followed by its options.
+ * @return int 0 upon success, -1 upon failure
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return -1;
+    }
+    std::string benchmark = argv[1];
+    std::string sourceSpec;
+    ReplayMode mode = ReplayMode::AsFastAsPossible;
+    bool render = false;
+    int detectInterval = 5;
+    bool motionGate = true;
+    int decimation = 0;
+    VoteMode voteMode = VoteMode::Sequential;
+    SequentialRule rule;
+    std::string expected;
+    std::vector<int> threadCounts = {1, 2, 4, 8};
+    int maxFrames = 100;
+    int repeat = 5;
+    int batchSize = 8;
+    double seconds = 2.0;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--source" && i + 1 < argc) {
+            sourceSpec = argv[++i];
+        } else if (arg == "--mode" && i + 1 < argc && std::string(argv[i + 1]) == "fast") {
+            mode = ReplayMode::AsFastAsPossible;
+            i++;
+        } else if (arg == "--mode" && i + 1 < argc && std::string(argv[i + 1]) == "realtime") {
+            mode = ReplayMode::Realtime;
+            i++;
+        } else if (arg == "--vote" && i + 1 < argc && std::string(argv[i + 1]) == "rounds") {
+            voteMode = VoteMode::Rounds;
+            i++;
+        } else if (arg == "--vote" && i + 1 < argc && std::string(argv[i + 1]) == "sliding") {
+            voteMode = VoteMode::Sliding;
+            i++;
+        } else if (arg == "--vote" && i + 1 < argc && std::string(argv[i + 1]) == "sequential") {
+            voteMode = VoteMode::Sequential;
+            i++;
+        } else if (arg == "--expect" && i + 1 < argc) {
+            expected = argv[++i];
+        } else if (arg == "--margin" && i + 1 < argc) {
+            rule.margin = std::max(0.1, std::atof(argv[++i]));
+        } else if (arg == "--min-votes" && i + 1 < argc) {
+            rule.minVotes = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--reject-weight" && i + 1 < argc) {
+            rule.rejectionWeight = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--render") {
+            render = true;
+        } else if (arg == "--detect-every" && i + 1 < argc) {
+            detectInterval = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--no-gate") {
+            motionGate = false;
+        } else if (arg == "--decimate" && i + 1 < argc) {
+            decimation = std::atoi(argv[++i]);
+            if (decimation != 1 && decimation != 2 && decimation != 4) {
+                std::cerr << "Error: --decimate must be 1, 2 or 4, got " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return -1;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threadCounts.clear();
+            std::stringstream list(argv[++i]);
+            std::string count;
+            while (std::getline(list, count, ',')) {
+                threadCounts.push_back(std::max(1, std::atoi(count.c_str())));
+            }
+        } else if (arg == "--frames" && i + 1 < argc) {
+            maxFrames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchSize = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::max(0.1, std::atof(argv[++i]));
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else {
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (benchmark == "replay" && !sourceSpec.empty()) {
+        return runReplay(sourceSpec, mode, render, detectInterval, motionGate, decimation, voteMode);
+    }
+    if (benchmark == "decide" && !sourceSpec.empty()) {
+        return runDecide(sourceSpec, expected, rule);
+    }
+    if (benchmark == "detect" && !sourceSpec.empty()) {
+        return runDetect(sourceSpec, threadCounts, maxFrames, decimation);
+    }
+    if (benchmark == "predict" && !sourceSpec.empty()) {
+        return runPredict(sourceSpec, maxFrames, batchSize);
+    }
+    if (benchmark == "gallery" && !sourceSpec.empty()) {
+        return runGallery(sourceSpec, maxFrames);
+    }
+    if (benchmark == "concurrent" && !sourceSpec.empty()) {
+        return runConcurrent(sourceSpec, threadCounts, maxFrames, seconds);
+    }
+    if (benchmark == "startup") {
+        return runStartup(repeat);
+    }
+    printUsage(argv[0]);
+    return -1;
+}
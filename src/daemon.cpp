@@ -0,0 +1,250 @@
+/**
+ * @file daemon.cpp
+ * @brief Headless recognition daemon that runs the recognition loop without any Qt widgets.
+ *
+ * Opens every camera listed in cameras.csv (or a single camera given on the command line) and runs the same
+ * detector, recognizer and temporal voting as the GUI on each of them, with overlay rendering turned off. Every
+ * camera has its own capture thread, pipeline and voting state; all of them share one loaded recognizer model.
+ * Each decision's permission level and door are looked up in names.csv, and access is granted when the person's
+ * door matches the door of the camera that saw them. Decisions are logged to standard output, appended to
+ * framedata.csv like the GUI does, and broadcast as one JSON line to every client connected to a local Unix socket.
+ *
+ * A camera's source may also be a video file or a directory of images. Recordings are replayed at their original
+ * timestamps, or as fast as possible with --replay fast; once every source has ended the daemon exits.
+ *
+ * Usage: OpenCVProjectDaemon [--cameras CSV | --camera INDEX | --source SPEC] [--replay fast|realtime] [--socket PATH]
+ */
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CameraChannel.h"
+#include "DecisionServer.h"
+#include "FaceRecognizerWrapper.h"
+#include "ProfileStore.h"
+
+namespace {
+
+std::atomic<bool> stopRequested{false};
+
+/// Signal handler for SIGINT/SIGTERM; the main loop polls the flag
+void handleStopSignal(int) {
+    stopRequested = true;
+}
+
+/// Escape a string for use inside a JSON string literal, including the control characters JSON forbids in one
+std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        unsigned char code = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else if (c == '\r') {
+            escaped += "\\r";
+        } else if (c == '\t') {
+            escaped += "\\t";
+        } else if (code < 0x20) {
+            char unicode[7];
+            std::snprintf(unicode, sizeof(unicode), "\\u%04x", code);
+            escaped += unicode;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/// Whether a --camera argument is a camera index: a small non-negative number
+bool isCameraIndex(const std::string& text) {
+    return !text.empty() && text.size() <= 4 &&
+           std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); });
+}
+
+/// Print the command-line usage
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program
+              << " [--cameras CSV | --camera INDEX | --source SPEC] [--replay fast|realtime] [--socket PATH]"
+              << std::endl;
+}
+
+/// Current local time formatted like the dates in names.csv
+std::string currentTime() {
+    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm local{};
+    localtime_r(&now, &local);
+    std::ostringstream out;
+    out << std::put_time(&local, "%Y-%m-%d %H:%M:%S");
+    return out.str();
+}
+
+}
+
+/**
+ * @brief Runs the recognition loop on every camera until SIGINT or SIGTERM is received
+ *
+ * Loads the trained model and labels once and shares them between all cameras, loads the profiles, starts the
+ * decision server and one CameraChannel per camera, then waits for a stop signal. Decisions arrive on the
+ * channels' render threads, so logging and the framedata.csv append are serialized with a mutex.
+ *
+ * @param cameras The cameras to open and the doors they guard.
+ * @param socketPath Path of the Unix socket decisions are served on.
+ * @param replay How sources that are recordings are paced.
+ * @return int 0 on a clean shutdown, -1 if no camera or the socket could not be opened.
+ */
+int runDaemon(const std::vector<CameraConfig>& cameras, const std::string& socketPath, ReplayMode replay) {
+    std::string root = PROJECT_ROOT_DIR;
+    std::string detectorConfig = root + "/textfiles/detector.yml";
+    std::string framedataPath = root + "/textfiles/framedata.csv";
+
+    auto faceRec = std::make_shared<FaceRecognizerWrapper>(1, 10, 8, 8, 100.0);
+    if (!faceRec->loadGallery(root + "/recognizer/gallery.bin")) {
+        faceRec->loadModel(root + "/recognizer/embeddings.xml");
+    }
+    faceRec->loadLabels(root + "/recognizer/labels.txt");
+    std::shared_ptr<const FaceRecognizerWrapper> sharedModel = faceRec;
+
+    std::shared_ptr<ProfileStore> profiles =
+        ProfileStore::open(root + "/textfiles/names.csv", root + "/recognizer/labels.txt");
+
+    DecisionServer server;
+    if (!server.start(socketPath)) {
+        return -1;
+    }
+    std::cout << "[INFO] Serving decisions on " << socketPath << std::endl;
+
+    std::mutex logMutex;
+    auto onDecision = [&](const CameraConfig& camera, const VoteDecision& decision) {
+        // Permission changes made in the admin panel apply from the next decision on. The profile is found by the
+        // label the track was decided on, as labels.txt maps it, so an unknown face (-1) never matches anyone
+        profiles->refresh();
+        Profile profile;
+        bool known = decision.label >= 0 && profiles->findByLabel(decision.label, profile);
+        std::string permission = known && !profile.permission.empty() ? profile.permission : "Unknown";
+        std::string door = known ? profile.door : "";
+        bool granted = known && !door.empty() && door == camera.door;
+        std::string time = currentTime();
+
+        std::ostringstream json;
+        json << "{\"time\":\"" << time << "\",\"camera\":\"" << jsonEscape(camera.name)
+             << "\",\"cameraDoor\":\"" << jsonEscape(camera.door) << "\",\"name\":\"" << jsonEscape(decision.name)
+             << "\",\"votes\":" << decision.count << ",\"permission\":\"" << jsonEscape(permission)
+             << "\",\"door\":\"" << jsonEscape(door) << "\",\"granted\":" << (granted ? "true" : "false") << "}";
+        server.broadcast(json.str());
+
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout << "[DECISION] " << time << " camera=" << camera.name << " name=" << decision.name
+                  << " votes=" << decision.count << " permission=" << permission << " door=" << door
+                  << (granted ? " GRANTED" : " DENIED") << std::endl;
+        if (decision.name != "Unknown") {
+            std::ofstream csvFile(framedataPath, std::ios::app);
+            if (csvFile.is_open()) {
+                csvFile << decision.name << "," << decision.count << "\n";
+            }
+        }
+    };
+
+    std::vector<std::unique_ptr<CameraChannel>> channels;
+    for (const auto& camera : cameras) {
+        auto channel = std::make_unique<CameraChannel>(camera, detectorConfig, root, sharedModel);
+        if (!channel->start(onDecision, replay)) {
+            std::cerr << "Warning: Camera " << camera.name << " (source " << camera.source << ") did not open" << std::endl;
+            continue;
+        }
+        std::cout << "[INFO] Recognition running on camera " << camera.name << " (source " << camera.source
+                  << ", door " << camera.door << ")" << std::endl;
+        channels.push_back(std::move(channel));
+    }
+    if (channels.empty()) {
+        std::cerr << "Error: No camera could be opened." << std::endl;
+        return -1;
+    }
+
+    auto allFinished = [&channels]() {
+        for (const auto& channel : channels) {
+            if (!channel->isFinished()) {
+                return false;
+            }
+        }
+        return true;
+    };
+    while (!stopRequested && !allFinished()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    std::cout << "[INFO] Shutting down" << std::endl;
+    channels.clear();
+    server.stop();
+    return 0;
+}
+
+/**
+ * @brief Parses the command line and runs the daemon
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv --cameras CSV reads the camera list (default textfiles/cameras.csv), --camera INDEX runs a single
+ *             camera instead, --source SPEC runs a single camera, video file or image directory, --replay fast|realtime
+ *             sets how recordings are paced (default realtime), --socket PATH sets the socket
+ *             (default /tmp/OpenCVProject.sock).
+ * @return int 0 upon success, -1 upon failure
+ */
+int main(int argc, char* argv[]) {
+    std::string camerasPath = std::string(PROJECT_ROOT_DIR) + "/textfiles/cameras.csv";
+    std::string socketPath = "/tmp/OpenCVProject.sock";
+    std::vector<CameraConfig> cameras;
+    ReplayMode replay = ReplayMode::Realtime;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--cameras" && i + 1 < argc) {
+            camerasPath = argv[++i];
+        } else if ((arg == "--camera" || arg == "--source") && i + 1 < argc) {
+            if (arg == "--camera" && !isCameraIndex(argv[i + 1])) {
+                std::cerr << "Error: --camera expects a camera index, got " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return -1;
+            }
+            CameraConfig camera;
+            camera.source = argv[++i];
+            camera.name = arg == "--camera" ? "camera" + camera.source : camera.source;
+            cameras.push_back(camera);
+        } else if (arg == "--replay" && i + 1 < argc && std::string(argv[i + 1]) == "fast") {
+            replay = ReplayMode::AsFastAsPossible;
+            i++;
+        } else if (arg == "--replay" && i + 1 < argc && std::string(argv[i + 1]) == "realtime") {
+            replay = ReplayMode::Realtime;
+            i++;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+    if (cameras.empty()) {
+        cameras = loadCameraConfigs(camerasPath);
+    }
+    if (cameras.empty()) {
+        std::cerr << "Error: No cameras configured." << std::endl;
+        return -1;
+    }
+
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+    return runDaemon(cameras, socketPath, replay);
+}
@@ -22,17 +22,34 @@
  */
 FaceManager::FaceManager(QWidget *parent, const QString &datasetPath)
     : m_parent(parent),
-      m_datasetPath(datasetPath)
+      m_datasetPath(datasetPath),
+      m_enroller(QFileInfo(datasetPath).absolutePath().toStdString())
 {
 }
 
+/// @brief The person a dataset folder belongs to
+/**
+ * @param folder A folder chosen in a dialog.
+ * @return The folder name if it is a person's folder directly inside the dataset, as training expects, otherwise an
+ *         empty string.
+ */
+QString FaceManager::personOf(const QString &folder) const {
+    QFileInfo info(folder);
+    if (QDir(info.absolutePath()) != QDir(m_datasetPath)) {
+        return QString();
+    }
+    return info.fileName();
+}
+
 /// @brief Open a Qtwidget file dialog to select a folder in the dataset to add images to.
 /**
  * This function allows the user to select one or more images to add to a specific folder in the dataset.
  * The user is prompted to select a folder within the dataset directory, and the selected images are copied
  * to that folder. If a file with the same name already exists, it will be replaced.
+ * New images are enrolled on their own; if any image replaced an existing one, whose face is still in the gallery,
+ * the whole person is enrolled again from their folder instead.
  */
-void FaceManager::addFace() {
+bool FaceManager::addFace() {
     // 1) Let the user pick one or more images
     QStringList fileNames = QFileDialog::getOpenFileNames(
         m_parent,
@@ -43,7 +60,7 @@ void FaceManager::addFace() {
 
     if (fileNames.isEmpty()) {
         qDebug() << "No images selected.";
-        return;
+        return false;
     }
 
     // 2) Ask the user to choose (or create) a folder inside the dataset folder
@@ -56,17 +73,19 @@ void FaceManager::addFace() {
 
     if (selectedDir.isEmpty()) {
         qDebug() << "No folder selected.";
-        return;
+        return false;
     }
 
     // Optional safety: ensure the selected folder is inside m_datasetPath
     if (!selectedDir.startsWith(m_datasetPath)) {
         QMessageBox::warning(m_parent, QObject::tr("Invalid Folder"),
             QObject::tr("Please select or create a folder inside '%1'.").arg(m_datasetPath));
-        return;
+        return false;
     }
 
     QDir targetDir(selectedDir);
+    std::vector<std::string> copiedFiles;
+    bool replaced = false;
     // 3) Copy the selected images to the target folder
     for (const QString &filePath : fileNames) {
         QFileInfo fileInfo(filePath);
@@ -75,6 +94,7 @@ void FaceManager::addFace() {
         // Handle name collisions: remove existing file
         if (QFile::exists(destFilePath)) {
             QFile::remove(destFilePath);
+            replaced = true;
         }
 
         bool success = QFile::copy(filePath, destFilePath);
@@ -82,16 +102,27 @@ void FaceManager::addFace() {
             qDebug() << "Failed to copy" << filePath << "to" << destFilePath;
         } else {
             qDebug() << "Copied" << filePath << "to" << destFilePath;
+            copiedFiles.push_back(destFilePath.toStdString());
         }
     }
 
-    QMessageBox::information(
-        m_parent,
-        QObject::tr("Add Face"),
-        QObject::tr("Successfully added %1 image(s) to:\n%2")
-            .arg(fileNames.size())
-            .arg(selectedDir)
-    );
+    // 4) Enroll the faces of the copied images, only the new images are processed. A replaced image's face is
+    //    still in the gallery and cannot be told apart from the others, so then the person is enrolled again
+    QString person = personOf(selectedDir);
+    int enrolled = -1;
+    if (!person.isEmpty()) {
+        enrolled = replaced ? m_enroller.reenroll(person.toStdString(), selectedDir.toStdString())
+                            : m_enroller.addImages(person.toStdString(), copiedFiles);
+    }
+
+    QString message = QObject::tr("Successfully added %1 image(s) to:\n%2").arg(fileNames.size()).arg(selectedDir);
+    if (enrolled >= 0) {
+        message += QObject::tr("\n\nEnrolled %1 face(s), recognition is up to date.").arg(enrolled);
+    } else {
+        message += QObject::tr("\n\nThe model could not be updated, train it to apply the change.");
+    }
+    QMessageBox::information(m_parent, QObject::tr("Add Face"), message);
+    return enrolled > 0;
 }
 
 /// @brief Open a Qtwidget file dialog to select a folder in the dataset to delete images from.
@@ -100,7 +131,7 @@ void FaceManager::addFace() {
  * The user is prompted to select a folder within the dataset directory, and the selected images are deleted
  * from that folder. If a file with the same name does not exist, it will be ignored.
  */
-void FaceManager::deleteFace() {
+bool FaceManager::deleteFace() {
     // 1) Ask the user to choose a folder in the dataset to delete images from.
     QString selectedDir = QFileDialog::getExistingDirectory(
         m_parent,
@@ -111,13 +142,13 @@ void FaceManager::deleteFace() {
 
     if (selectedDir.isEmpty()) {
         qDebug() << "No folder selected.";
-        return;
+        return false;
     }
 
     if (!selectedDir.startsWith(m_datasetPath)) {
         QMessageBox::warning(m_parent, QObject::tr("Invalid Folder"),
             QObject::tr("Please select a folder inside '%1'.").arg(m_datasetPath));
-        return;
+        return false;
     }
 
     // 2) Let the user select one or more images within that folder to delete
@@ -130,7 +161,7 @@ void FaceManager::deleteFace() {
 
     if (fileNames.isEmpty()) {
         qDebug() << "No images selected for deletion.";
-        return;
+        return false;
     }
 
     // 3) Delete the selected images
@@ -147,11 +178,19 @@ void FaceManager::deleteFace() {
         }
     }
 
-    QMessageBox::information(
-        m_parent,
-        QObject::tr("Delete Face"),
-        QObject::tr("Successfully deleted %1 image(s) from:\n%2")
-            .arg(deletedCount)
-            .arg(selectedDir)
-    );
+    // 4) Drop the person's rows from the gallery and enroll the images that are left
+    QString person = personOf(selectedDir);
+    int enrolled = -1;
+    if (deletedCount > 0 && !person.isEmpty()) {
+        enrolled = m_enroller.reenroll(person.toStdString(), selectedDir.toStdString());
+    }
+
+    QString message = QObject::tr("Successfully deleted %1 image(s) from:\n%2").arg(deletedCount).arg(selectedDir);
+    if (enrolled >= 0) {
+        message += QObject::tr("\n\n%1 face(s) remain enrolled, recognition is up to date.").arg(enrolled);
+    } else if (deletedCount > 0) {
+        message += QObject::tr("\n\nThe model could not be updated, train it to apply the change.");
+    }
+    QMessageBox::information(m_parent, QObject::tr("Delete Face"), message);
+    return enrolled >= 0;
 }
\ No newline at end of file
@@ -5,10 +5,14 @@
 #include <QStringList>
 #include <QWidget>
 
+#include "FaceEnroller.h"
+
 /// @brief This class manages the addition and deletion of face images for profiles within the dataset.
 /**
  * This class allows for the addition and deletion of face images for a preexisting profile, or for new profiles
  * in the dataset. The class uses the Qt GUI libraries to prompt the user for a folder within the dataset directory.
+ * Changes to a person's folder are applied to the trained gallery right away through a FaceEnroller, so they take
+ * effect without retraining the whole dataset.
  *
  * @file facemanager.h
  * @author Lukas Bozinov
@@ -29,21 +33,30 @@ public:
     /**
      * This function allows the user to select one or more images to add to a specific folder in the dataset.
      * The user is prompted to select a folder within the dataset directory, and the selected images are copied
-     * to that folder. If a file with the same name already exists, it will be replaced.
+     * to that folder. If a file with the same name already exists, it will be replaced. The faces in the copied
+     * images are then enrolled under the folder's person.
+     *
+     * @return true if the gallery on disk was updated and should be reloaded.
      */
-    void addFace();
+    bool addFace();
 
     /// @brief Open a Qtwidget file dialog to select a folder in the dataset to delete images from.
     /**
      * This function allows the user to select one or more images to delete from a specific folder in the dataset.
      * The user is prompted to select a folder within the dataset directory, and the selected images are deleted
-     * from that folder. If a file with the same name does not exist, it will be ignored.
+     * from that folder. If a file with the same name does not exist, it will be ignored. The folder's person is then
+     * enrolled again from the images that are left.
+     *
+     * @return true if the gallery on disk was updated and should be reloaded.
      */
-    void deleteFace();
+    bool deleteFace();
 
 private:
     QWidget *m_parent;      // Used for dialogs
     QString m_datasetPath;  // E.g., PROJECT_ROOT_DIR + "/dataset"
+    FaceEnroller m_enroller; // Applies changes to recognizer/gallery.bin next to the dataset
+
+    QString personOf(const QString &folder) const;
 };
 
 #endif // FACEMANAGER_H
\ No newline at end of file
@@ -1,5 +1,6 @@
 
 #include <QApplication>
+#include <QCommandLineParser>
 #include "mainwindow.h"
 
 /**
@@ -9,6 +10,7 @@
  * 
  * Initializes the Qt application, applies a dark mode theme to the UI, ensures the 
  * native title bar is independant of Qt styles and launches the MainWindow instance.
+ * An optional --source argument replays a video file or image directory instead of opening a camera.
  * Handles user interactions by entering the QT event loop.
  * 
  * @param argc The number of command-line arguments.
@@ -29,7 +31,13 @@ int main(int argc, char *argv[]) {
         "QPushButton:hover { background-color: #505055; }"
     );
 
-    MainWindow window;
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption sourceOption("source", "Camera index, video file or image directory to read frames from.", "spec");
+    parser.addOption(sourceOption);
+    parser.process(app);
+
+    MainWindow window(nullptr, parser.value(sourceOption));
     window.show();
     return app.exec();
 }
\ No newline at end of file
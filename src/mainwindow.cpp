@@ -26,26 +26,27 @@
  * @brief Construct a new Main Window:: Main Window object and initializes the UI and face recognition components.
  * 
  * Constructs the MainWindow by initializing all labels, buttons, and progress bar. Setting the font-size in the style sheets.
- * Sets a window with a fixed size and title. Builds the layout by calling setupUI() method. Prepares the dataset directory and
- * clears the framedata CSV file. Opens the default camera, displaying an error message upon failure. Creates an instance of
- * both FaceDetector & FaceRecognizerWrapper. Connects to a Qtimer to refresh the video feed every 30 miliseconds by calling
- * the updateFrame() method.
+ * Loads the employee profiles once into the shared ProfileStore. Sets a window with a fixed size and title. Builds the layout by calling setupUI() method. Prepares the dataset directory and
+ * clears the framedata CSV file. Creates an instance of both FaceDetector & FaceRecognizerWrapper and the recognition
+ * pipeline that runs them. Starts the frame grabber on the given source or the first camera in cameras.csv, displaying an
+ * error message upon failure, then starts the pipeline on the grabber's ring. Every frame the pipeline finishes is voted on
+ * by voteOn() on the render thread, and presentLatest() shows the newest frame and decision on the GUI thread.
  * 
  * @param parent The parent widget.
+ * @param source Camera index, video file or image directory to read from; empty uses cameras.csv.
  */
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(QWidget *parent, const QString &source)
     : QMainWindow(parent),
       videoLabel(new QLabel(this)),
       nameLabel(new QLabel("Name: ", this)),
       permLabel(new QLabel("Permission Level: ", this)),
       adminButton(new QPushButton("Admin Panel", this)),
       trainButton(new QPushButton("Train Model", this)),
+      trainProgressBar(new QProgressBar(this)),
       addFaceButton(new QPushButton("Add Face", this)),
       deleteFaceButton(new QPushButton("Delete Face", this)),
-      timer(new QTimer(this)),
-      trainProgressBar(new QProgressBar(this)),
-      detector(nullptr),
-      faceRec(nullptr)
+      pipeline(nullptr),
+      detector(nullptr)
 {
     // Increase font sizes via style sheets
     nameLabel->setStyleSheet("font-size: 24pt;");
@@ -57,6 +58,8 @@ MainWindow::MainWindow(QWidget *parent)
 
     QString datasetPath = QString(PROJECT_ROOT_DIR) + "/dataset";
     faceManager = new FaceManager(this, datasetPath);
+    profiles = ProfileStore::open(std::string(PROJECT_ROOT_DIR) + "/textfiles/names.csv",
+                                  std::string(PROJECT_ROOT_DIR) + "/recognizer/labels.txt");
 
     // Basic window setup
     setWindowTitle("Face Recognition - Lukas, Naween, Kevin, Matthew, Woorim");
@@ -71,34 +74,57 @@ MainWindow::MainWindow(QWidget *parent)
     std::ofstream csvClear("../textfiles/framedata.csv", std::ofstream::out | std::ofstream::trunc);
     csvClear.close();
 
-    // Open the default camera
-    cap.open(0);
-    if (!cap.isOpened()) {
+    // Initialize FaceDetector & FaceRecognizerWrapper
+    detector = new FaceDetector();
+    detector->loadConfig("../textfiles/detector.yml", "..");
+    faceRec = loadRecognizer();
+    voter.setReferenceDistance(faceRec->getGallery()->acceptThreshold());
+
+    // Detection, recognition and rendering run on worker threads; only finished frames reach the GUI thread
+    pipeline = new RecognitionPipeline(*detector, faceRec);
+    pipeline->setPreprocessParams(loadPreprocessConfig("../textfiles/preprocess.yml"));
+    // Every frame is voted on right here on the render thread. The GUI thread gets at most one queued call, which
+    // shows the newest frame and decision, so a stalled GUI never piles up frames in its event queue
+    pipeline->setResultCallback([this](FrameResult &&result) {
+        std::lock_guard<std::mutex> lock(latestMutex);
+        voteOn(result);
+        if (!result.rendered.empty()) {
+            latestFrame = std::move(result.rendered);
+        }
+        if (!presentQueued) {
+            presentQueued = true;
+            QMetaObject::invokeMethod(this, [this]() { presentLatest(); }, Qt::QueuedConnection);
+        }
+    });
+
+    // Open the source given on the command line, otherwise the first camera listed in cameras.csv (the default
+    // camera if there is none), on the capture thread. Recordings are replayed at their original speed.
+    std::string sourceSpec = source.toStdString();
+    if (sourceSpec.empty()) {
+        std::vector<CameraConfig> cameras = loadCameraConfigs(std::string(PROJECT_ROOT_DIR) + "/textfiles/cameras.csv");
+        sourceSpec = cameras.empty() ? "0" : cameras.front().source;
+    }
+    if (!grabber.start(FrameSource::create(sourceSpec), ReplayMode::Realtime)) {
         videoLabel->setText("Error: Could not open camera.");
         return;
     }
-
-    // Initialize FaceDetector & FaceRecognizerWrapper
-    detector = new FaceDetector("../cascades/haarcascade_frontalface_default.xml");
-    faceRec = new FaceRecognizerWrapper(1, 10, 8, 8, 100.0);
-    faceRec->loadModel("../recognizer/embeddings.xml");
-    faceRec->loadLabels("../recognizer/labels.txt");
-
-    // Update frames via QTimer
-    connect(timer, &QTimer::timeout, this, &MainWindow::updateFrame);
-    timer->start(30);
+    pipeline->start(grabber.frames());
 }
 
 /**
  * @brief Destroy the Main Window:: Main Window object
  * 
- * Destroys the MainWindow by deleting detector, faceRec, faceManager, and release cap if it is opened.
+ * Destroys the MainWindow by stopping the recognition pipeline and the frame grabber, which releases the camera, and
+ * deleting pipeline, detector and faceManager. A model reload still in progress is waited for first. The recognizer
+ * is released with the last reference to it.
  */
 MainWindow::~MainWindow() {
-    if (cap.isOpened())
-        cap.release();
+    if (reloadThread) {
+        reloadThread->wait();
+    }
+    delete pipeline;
+    grabber.stop();
     delete detector;
-    delete faceRec;
     delete faceManager;
 }
 
@@ -212,166 +238,127 @@ void MainWindow::setupUI() {
 }
 
 /**
- * @brief Update frame from camera and process face recognition
+ * @brief Vote on the faces of a processed frame
  * 
- * This function captures a frame from the camera, converts it to grayscale, and detects faces 
- * using the `detector` object. Every detected face gets surrounded by a bounding box. If the 
- * detected face has a confidence level that is greater than 7 it is stored within a buffer.
- * Every 60 frames, the most frequently identified name is determined and gets logged into 
- * framedata.csv alongside the name's permission level. After the ui updates the door labels 
- * based on the which door the user is allowed to access. Finally the name is overlaid onto the frame
- * which has a white border added to it and the videolabel is updated to display the processed frame.
+ * Called on the render thread for every frame the recognition pipeline finishes, in capture order, with latestMutex
+ * held. Every face the pipeline accepted, with a confidence level above 7% of the recognizer's threshold (7 on the
+ * full model's scale), has its label added as a vote for its track to the temporal voter. As soon as the votes of a
+ * track favor one name clearly enough, and after 60 votes at the latest, that name gets logged into framedata.csv
+ * alongside its vote count, and again whenever the decided name changes. The decision is kept for presentLatest().
  * 
+ * @param result The detected faces and their predictions
  */
-void MainWindow::updateFrame() {
-    cv::Mat frame, gray;
-    cap >> frame;
-    if (frame.empty()) {
-        qDebug() << "Error: blank frame grabbed.";
-        return;
-    }
-
-    // Convert to grayscale for detection/recognition
-    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
-
-    // Detect faces
-    auto faces = detector->detectFaces(gray);
-    for (const auto &rect : faces) {
-        cv::rectangle(frame, rect, cv::Scalar(0, 255, 0), 2);
-        cv::Mat faceROI = gray(rect);
-        double confidence = 0.0;
-        int predictedLabel = faceRec->predict(faceROI, confidence);
-
-        std::string labelName = "Unknown";
-        if (confidence > 7) {
-            labelName = faceRec->getLabelName(predictedLabel);
-            nameBuffer.push_back(labelName);
-
-            // Every 60 frames, compute the mode and update labels and door outlines
-            if (nameBuffer.size() >= 60) {
-                std::map<std::string, int> frequency;
-                for (const auto &name : nameBuffer) {
-                    frequency[name]++;
-                }
-                std::string mostFrequentName = "Unknown";
-                int maxCount = 0;
-                for (const auto &pair : frequency) {
-                    if (pair.second > maxCount) {
-                        mostFrequentName = pair.first;
-                        maxCount = pair.second;
-                    }
-                }
-
-                std::ofstream csvFile("../textfiles/framedata.csv", std::ios::app);
-                if (csvFile.is_open() && mostFrequentName != "Unknown") {
-                    csvFile << mostFrequentName << "," << maxCount << "\n";
-                    csvFile.close();
-                }
-                nameBuffer.clear();
-
-                // Update the name label
-                QString mostFreqName = QString::fromStdString(mostFrequentName);
-                nameLabel->setText(QString("Name: %1").arg(mostFreqName));
-
-                // Update the permission level label (3rd field)
-                QString permissionLevel = getPermissionLevelForName(mostFreqName);
-                permLabel->setText(QString("Permission Level: %1").arg(permissionLevel));
-
-                // Get the door number (4th field) and update door label outlines accordingly
-                QString doorNum = getDoorNumberForName(mostFreqName);
-                // For each door label, set border green if its number matches doorNum; else white
-                QString defaultStyle = "font-size: 18pt; color: white; border: 2px solid white; padding: 10px;";
-                QString activeStyle = "font-size: 18pt; color: white; border: 2px solid lime; padding: 10px;";
-                if (doorLabel1) {
-                    doorLabel1->setStyleSheet((doorNum == "1") ? activeStyle : defaultStyle);
-                }
-                if (doorLabel2) {
-                    doorLabel2->setStyleSheet((doorNum == "2") ? activeStyle : defaultStyle);
-                }
-                if (doorLabel3) {
-                    doorLabel3->setStyleSheet((doorNum == "3") ? activeStyle : defaultStyle);
-                }
+void MainWindow::voteOn(const FrameResult &result) {
+    for (const auto &face : result.faces) {
+        VoteDecision decision;
+        if (face.accepted && voter.addVote(face.trackId, face.label, face.confidence, face.name, decision)) {
+            std::ofstream csvFile("../textfiles/framedata.csv", std::ios::app);
+            if (csvFile.is_open() && decision.name != "Unknown") {
+                csvFile << decision.name << "," << decision.count << "\n";
+                csvFile.close();
             }
+            latestDecision = decision;
+            hasLatestDecision = true;
         }
-        cv::putText(frame, labelName, cv::Point(rect.x, rect.y - 5),
-                    cv::FONT_HERSHEY_DUPLEX, 1.0, cv::Scalar(0, 255, 0), 1);
     }
+    voter.endFrame();
+}
 
-    int thickness = 4;
-    cv::rectangle(frame,
-                  cv::Point(0, 0),
-                  cv::Point(frame.cols - 1, frame.rows - 1),
-                  cv::Scalar(255, 255, 255),
-                  thickness);
-
-    cv::cvtColor(frame, frame, cv::COLOR_BGR2RGB);
+/**
+ * @brief Display the newest frame and decision
+ * 
+ * Called on the GUI thread, queued by the render thread at most once at a time. Takes the newest rendered frame and
+ * the newest decision out of the mailbox; frames the GUI had no time for were voted on but are never shown.
+ */
+void MainWindow::presentLatest() {
+    cv::Mat frame;
+    VoteDecision decision;
+    bool decided;
+    {
+        std::lock_guard<std::mutex> lock(latestMutex);
+        frame = std::move(latestFrame);
+        latestFrame.release();
+        decision = latestDecision;
+        decided = hasLatestDecision;
+        hasLatestDecision = false;
+        presentQueued = false;
+    }
+    if (decided) {
+        showDecision(decision);
+    }
+    if (frame.empty()) {
+        return;
+    }
     QImage qimg(frame.data, frame.cols, frame.rows, frame.step, QImage::Format_RGB888);
     videoLabel->setPixmap(QPixmap::fromImage(qimg));
 }
 
 /**
- * @brief Helper function to get permission level (3rd field) from names.csv for a given name
+ * @brief Show a decision in the labels
  * 
- * Opens the file path to the names.csv text file, where the employee data is stored. 
- * From there it checks to see if the file is able to be accessed, outputting an error message on failure.
- * Upon success, iterates through each line of the file, splicing at every ','. When the line is not empty
- * and the name in the line (index 0) and the inputted name matches, the file is closed and the permission level
- * (index 2) is returned.
+ * Updates the name and permission level labels, then outlines the door labels based on which door the user is
+ * allowed to access.
  * 
- * @param name QString representing the name to get the permission level for
- * @return QString The permission level that the given name has, empty upon failure to locate the employee in the database
+ * @param decision The decided track
  */
-QString MainWindow::getPermissionLevelForName(const QString &name) {
-    QString textfilePath = QString(PROJECT_ROOT_DIR) + "/textfiles";
-    QFile file(textfilePath + "/names.csv");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qDebug() << "Error opening file in getPermissionLevelForName:" << file.errorString();
-        return "Unknown";
+void MainWindow::showDecision(const VoteDecision &decision) {
+    // Update the name label
+    QString mostFreqName = QString::fromStdString(decision.name);
+    nameLabel->setText(QString("Name: %1").arg(mostFreqName));
+
+    // Update the permission level label (3rd field); edits made in the admin panel are picked up here
+    profiles->refresh();
+    QString permissionLevel = getPermissionLevelForLabel(decision.label);
+    permLabel->setText(QString("Permission Level: %1").arg(permissionLevel));
+
+    // Get the door number (4th field) and update door label outlines accordingly
+    QString doorNum = getDoorNumberForLabel(decision.label);
+    // For each door label, set border green if its number matches doorNum; else white
+    QString defaultStyle = "font-size: 18pt; color: white; border: 2px solid white; padding: 10px;";
+    QString activeStyle = "font-size: 18pt; color: white; border: 2px solid lime; padding: 10px;";
+    if (doorLabel1) {
+        doorLabel1->setStyleSheet((doorNum == "1") ? activeStyle : defaultStyle);
     }
-    QTextStream in(&file);
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        QStringList parts = line.split(",");
-        if (!parts.isEmpty() && parts[0] == name) {
-            file.close();
-            return (parts.size() >= 3) ? parts[2] : "Unknown";
-        }
+    if (doorLabel2) {
+        doorLabel2->setStyleSheet((doorNum == "2") ? activeStyle : defaultStyle);
+    }
+    if (doorLabel3) {
+        doorLabel3->setStyleSheet((doorNum == "3") ? activeStyle : defaultStyle);
     }
-    file.close();
-    return "Unknown";
 }
 
 /**
- * @brief Helper function to get door number (4th field) from names.csv for a given name
+ * @brief Helper function to get permission level (3rd field) from names.csv for a given recognizer label
  * 
- * Opens the file path to the names.csv text file, where the employee data is stored. 
- * From there it checks to see if the file is able to be accessed, outputting an error message on failure.
- * Upon success, iterates through each line of the file, splicing at every ','. When the line is not empty
- * and the name in the line (index 0) and the inputted name matches, the file is closed and the door number
- * (index 3) is returned.
+ * Looks the label up in the profile store, which holds names.csv indexed by the labels of labels.txt, so no file is
+ * read per decision and a decision is checked against the label it was voted on rather than a name the voter kept.
  * 
- * @param name QString representing the name to get the allowed door for
- * @return QString The door number that the given name is allowed to access, empty upon failure to locate the employee in the database
+ * @param label The decided label, -1 for an unknown face
+ * @return QString The permission level of the label's employee, "Unknown" upon failure to locate the employee in the database
  */
-QString MainWindow::getDoorNumberForName(const QString &name) {
-    QString textfilePath = QString(PROJECT_ROOT_DIR) + "/textfiles";
-    QFile file(textfilePath + "/names.csv");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qDebug() << "Error opening file in getDoorNumberForName:" << file.errorString();
-        return "";
+QString MainWindow::getPermissionLevelForLabel(int label) {
+    Profile profile;
+    if (label < 0 || !profiles->findByLabel(label, profile) || profile.permission.empty()) {
+        return "Unknown";
     }
-    QTextStream in(&file);
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        QStringList parts = line.split(",");
-        if (!parts.isEmpty() && parts[0] == name) {
-            file.close();
-            // Return the 4th field (index 3) if available
-            return (parts.size() >= 4) ? parts[3].trimmed() : "";
-        }
+    return QString::fromStdString(profile.permission);
+}
+
+/**
+ * @brief Helper function to get door number (4th field) from names.csv for a given recognizer label
+ * 
+ * Looks the label up in the profile store, which holds names.csv indexed by the labels of labels.txt, so no file is
+ * read per decision.
+ * 
+ * @param label The decided label, -1 for an unknown face
+ * @return QString The door number that the label's employee is allowed to access, empty upon failure to locate the employee in the database
+ */
+QString MainWindow::getDoorNumberForLabel(int label) {
+    Profile profile;
+    if (label < 0 || !profiles->findByLabel(label, profile)) {
+        return "";
     }
-    file.close();
-    return "";
+    return QString::fromStdString(profile.door);
 }
 
 /**
@@ -390,7 +377,8 @@ void MainWindow::openPinWindow() {
  * @brief Opens the training project.
  * 
  * Allows the user to retrain the model so their edits to the databases affect the model. While the model 
- * is training, a progress bar is displayed to the user and deleted upon completion.
+ * is training, a progress bar is displayed to the user and deleted upon completion. When training succeeds the new
+ * model is loaded and swapped in without restarting, see reloadRecognizer().
  */
 void MainWindow::openTrainProject() {
     QString exePath = QCoreApplication::applicationDirPath() + "/OpenCVProjectTrain";
@@ -398,11 +386,15 @@ void MainWindow::openTrainProject() {
     trainProgressBar->setRange(0, 0);
     connect(trainProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
             this, [this, trainProcess](int exitCode, QProcess::ExitStatus exitStatus) {
-                Q_UNUSED(exitCode);
-                Q_UNUSED(exitStatus);
+                bool trained = exitStatus == QProcess::NormalExit && exitCode == 0;
                 trainProgressBar->setRange(0, 100);
-                trainProgressBar->setValue(100);
+                trainProgressBar->setValue(trained ? 100 : 0);
                 trainProcess->deleteLater();
+                if (trained) {
+                    reloadRecognizer();
+                } else {
+                    qDebug() << "Training failed with exit code" << exitCode << ", keeping the current model";
+                }
             });
     trainProcess->start(exePath, QStringList());
     if (!trainProcess->waitForStarted()) {
@@ -413,26 +405,79 @@ void MainWindow::openTrainProject() {
     }
 }
 
+/**
+ * @brief Loads the recognizer from gallery.bin, or from embeddings.xml if there is no gallery, and labels.txt
+ *
+ * @return The loaded recognizer; its gallery is empty if no model could be loaded
+ */
+std::shared_ptr<FaceRecognizerWrapper> MainWindow::loadRecognizer() {
+    auto model = std::make_shared<FaceRecognizerWrapper>(1, 10, 8, 8, 100.0);
+    if (!model->loadGallery("../recognizer/gallery.bin")) {
+        model->loadModel("../recognizer/embeddings.xml");
+    }
+    model->loadLabels("../recognizer/labels.txt");
+    return model;
+}
+
+/**
+ * @brief Loads the retrained or re-enrolled model on a background thread and swaps it into the running pipeline
+ *
+ * Loading happens off the GUI thread and recognition keeps running on the current model meanwhile. Once loaded, the
+ * model replaces faceRec and the pipeline's recognizer in one step on the GUI thread; frames already being
+ * recognized finish with the old model, which is freed with its last reference. If the new model cannot be
+ * loaded the current one stays in use.
+ */
+void MainWindow::reloadRecognizer() {
+    if (reloadThread) {
+        reloadThread->wait();
+    }
+    auto loaded = std::make_shared<std::shared_ptr<FaceRecognizerWrapper>>();
+    reloadThread = QThread::create([loaded]() { *loaded = loadRecognizer(); });
+    connect(reloadThread, &QThread::finished, this, [this, loaded]() {
+        if (!*loaded || (*loaded)->getGallery()->empty()) {
+            qDebug() << "The updated model could not be loaded, keeping the current model";
+            return;
+        }
+        faceRec = *loaded;
+        pipeline->setRecognizer(faceRec);
+        // Votes and names cast under the old model's labels must not decide for the new one
+        std::lock_guard<std::mutex> lock(latestMutex);
+        voter.reset();
+        voter.setReferenceDistance(faceRec->getGallery()->acceptThreshold());
+        qDebug() << "Switched to the updated model";
+    });
+    connect(reloadThread, &QThread::finished, reloadThread, &QObject::deleteLater);
+    reloadThread->start();
+}
+
 /**
  * @brief Calls addFace() of faceManager
  * 
- * Enables the user to add a new face and/or employee by stopping the timer, and calling addFace() from faceManager.
- * Upon completion, timer resumes.
+ * Enables the user to add a new face and/or employee by pausing the recognition pipeline, and calling addFace() from faceManager.
+ * Upon completion, processing resumes. The capture thread keeps running, so the first frame afterwards is current.
+ * The new faces are enrolled into the gallery by faceManager, which is then reloaded without retraining.
  */
 void MainWindow::addFace() {
-    timer->stop();
-    faceManager->addFace();
-    timer->start(30);
+    pipeline->setPaused(true);
+    bool updated = faceManager->addFace();
+    pipeline->setPaused(false);
+    if (updated) {
+        reloadRecognizer();
+    }
 }
 
 /**
  * @brief Calls deleteFace() of faceManager
  * 
- * Enables the user to delete a face and/or employee by stopping the timer, and calling deleteFace() from faceManager.
- * Upon completion, timer resumes.
+ * Enables the user to delete a face and/or employee by pausing the recognition pipeline, and calling deleteFace() from faceManager.
+ * Upon completion, processing resumes. The capture thread keeps running, so the first frame afterwards is current.
+ * The person's remaining faces are enrolled again by faceManager and the gallery is reloaded without retraining.
  */
 void MainWindow::deleteFace() {
-    timer->stop();
-    faceManager->deleteFace();
-    timer->start(30);
+    pipeline->setPaused(true);
+    bool updated = faceManager->deleteFace();
+    pipeline->setPaused(false);
+    if (updated) {
+        reloadRecognizer();
+    }
 }
\ No newline at end of file
@@ -4,16 +4,25 @@
 
 #include <QMainWindow>
 #include <QLabel>
-#include <QTimer>
 #include <QPushButton>
 #include <QProgressBar>
+#include <QPointer>
+#include <QThread>
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
 // Include your face detection/recognition headers
 #include "FaceDetector.h"
 #include "FaceRecognizerWrapper.h"
+#include "CameraChannel.h"
+#include "FrameGrabber.h"
+#include "ProfileStore.h"
+#include "RecognitionPipeline.h"
+#include "TemporalVoter.h"
 #include "facemanager.h"
 
 
@@ -37,32 +46,33 @@ public:
      * @brief Construct a new Main Window object
      * 
      * @param parent Pointer to the parent widget
+     * @param source Camera index, video file or image directory to read from; empty uses cameras.csv
      */
-    explicit MainWindow(QWidget *parent = nullptr);
+    explicit MainWindow(QWidget *parent = nullptr, const QString &source = QString());
     ~MainWindow();
 
     private slots:
         /**
-         * @brief Updates the frame from the camera and processes the face recognition
+         * @brief Displays the newest frame and decision handed over by the render thread
          * 
          */
-        void updateFrame();
+        void presentLatest();
 
     /**
-     * @brief Get the Permission Level For Name object
+     * @brief Get the Permission Level For Label object
      * 
-     * @param name The name to retrieve the permission level of
-     * @return * QString The permission level for the inputted name
+     * @param label The recognizer label to retrieve the permission level of
+     * @return * QString The permission level for the inputted label
      */
-    QString getPermissionLevelForName(const QString &name);
+    QString getPermissionLevelForLabel(int label);
 
     /**
-     * @brief Get the Door Number For Name object
+     * @brief Get the Door Number For Label object
      * 
-     * @param name The name to retrieve the allowed door entry of
-     * @return QString The door number that the inputted name is allowed to access
+     * @param label The recognizer label to retrieve the allowed door entry of
+     * @return QString The door number that the inputted label is allowed to access
      */
-    QString getDoorNumberForName(const QString &name);
+    QString getDoorNumberForLabel(int label);
 
 public slots:
         /**
@@ -94,7 +104,6 @@ private:
     QLabel *permLabel;     // Static text for permission level (updated during execution)
     QPushButton *adminButton;
     QPushButton *trainButton;
-    QTimer *timer;
     QProgressBar *trainProgressBar;
     QPushButton *addFaceButton;
     QPushButton *deleteFaceButton;
@@ -103,11 +112,46 @@ private:
     QLabel *doorLabel3;
 
     // OpenCV / face recognition members
-    cv::VideoCapture cap;
+    FrameGrabber grabber;              // Owns the camera and reads it on its own thread
+    RecognitionPipeline *pipeline;     // Detect/recognize/render workers fed by the grabber
     FaceDetector *detector;
-    FaceRecognizerWrapper *faceRec;
+    std::shared_ptr<const FaceRecognizerWrapper> faceRec; // Read-only model shared with the pipeline
     FaceManager *faceManager;
-    std::vector<std::string> nameBuffer;
+    TemporalVoter voter;               // Per-track majority vote over accepted predictions, fed by the render thread
+    std::mutex latestMutex;            // Guards voter and the newest result below, shared with the render thread
+    cv::Mat latestFrame;               // Newest rendered frame not shown yet
+    VoteDecision latestDecision;       // Newest decision not shown yet
+    bool hasLatestDecision = false;
+    bool presentQueued = false;        // Whether a call to presentLatest() is already queued on the GUI thread
+    std::shared_ptr<ProfileStore> profiles; // names.csv indexed in memory, shared with the admin panel
+    QPointer<QThread> reloadThread;    // Loads an updated model in the background, null when idle
+
+    /**
+     * @brief Votes on the accepted faces of a finished frame; called on the render thread with latestMutex held
+     *
+     * @param result The detected faces and their predictions
+     */
+    void voteOn(const FrameResult &result);
+
+    /**
+     * @brief Shows a decision in the name, permission and door labels
+     *
+     * @param decision The decided track
+     */
+    void showDecision(const VoteDecision &decision);
+
+    /**
+     * @brief Loads the recognizer from gallery.bin, or from embeddings.xml if there is no gallery, and labels.txt
+     *
+     * @return The loaded recognizer; its gallery is empty if no model could be loaded
+     */
+    static std::shared_ptr<FaceRecognizerWrapper> loadRecognizer();
+
+    /**
+     * @brief Loads the retrained or re-enrolled model on a background thread and swaps it into the running pipeline
+     *
+     */
+    void reloadRecognizer();
 
     /**
      * @brief Creates the layout that the UI will use
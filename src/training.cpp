@@ -9,6 +9,9 @@
  * or has an unreadable face. The remaining images are resized and added to the training dataset while getting a unique
  * labelID. Finally dots are added to the faces and the model is trained
  * using the training dataset and saved in the path defined at the beginning.
+ *
+ * With --convert MODEL GALLERY it instead converts an existing embeddings.xml into the binary gallery file the
+ * recognition programs map at startup, so a model trained by an older build does not need retraining.
  */
 #include <opencv2/face.hpp>
 #include <opencv2/imgproc.hpp>
@@ -21,9 +24,16 @@
 
 // Include our FaceDetector class header
 #include "FaceDetector.h"
+#include "FaceEnroller.h"
+#include "FacePreprocessor.h"
+#include "LbphGallery.h"
 
 namespace fs = std::filesystem;
 
+// Compact gallery written next to the model: uniform-pattern bins quantized to 16 bits, about 40 times smaller than
+// the model's 1024 float bins per cell
+const GalleryFormat kGalleryFormat{true, 16};
+
 /**
  * @brief Trains the face recognizer model using labeled images
  * 
@@ -38,20 +48,27 @@ namespace fs = std::filesystem;
 int training() {
     std::cout << "Project root directory: " << PROJECT_ROOT_DIR << "\n";
 
-    // Define paths for dataset, cascade, model, and labels
+    // Define paths for dataset, detector config, model, and labels
     std::string datasetPath = std::string(PROJECT_ROOT_DIR) + "/dataset";
-    std::string cascadePath = std::string(PROJECT_ROOT_DIR) + "/cascades/haarcascade_frontalface_default.xml";
+    std::string detectorConfig = std::string(PROJECT_ROOT_DIR) + "/textfiles/detector.yml";
     std::string modelPath = std::string(PROJECT_ROOT_DIR) + "/recognizer/embeddings.xml";
     std::string labelsPath = std::string(PROJECT_ROOT_DIR) + "/recognizer/labels.txt";
+    std::string galleryPath = std::string(PROJECT_ROOT_DIR) + "/recognizer/gallery.bin";
 
     // Verify paths
     std::cout << "[INFO] Dataset path: " << datasetPath << "\n";
-    std::cout << "[INFO] Cascade path: " << cascadePath << "\n";
+    std::cout << "[INFO] Detector config: " << detectorConfig << "\n";
     std::cout << "[INFO] Model path: " << modelPath << "\n";
     std::cout << "[INFO] Labels path: " << labelsPath << "\n";
 
-    // Create a FaceDetector instance with the cascade file
-    FaceDetector detector(cascadePath);
+    // Create a FaceDetector with the backend selected in detector.yml
+    FaceDetector detector;
+    detector.loadConfig(detectorConfig, PROJECT_ROOT_DIR);
+    std::cout << "[INFO] Detector backend: " << detector.backendName() << "\n";
+
+    // Crops faces exactly as live recognition does
+    FacePreprocessor preprocessor(loadPreprocessConfig(std::string(PROJECT_ROOT_DIR) + "/textfiles/preprocess.yml"));
+    std::cout << "[INFO] Face crops: " << preprocessor.params().size << "x" << preprocessor.params().size << "\n";
 
     // Containers to store training images and corresponding labels
     std::vector<cv::Mat> trainingImages;
@@ -80,30 +97,13 @@ int training() {
                     if (imgEntry.is_regular_file()) {
                         std::string imagePath = imgEntry.path().string();
                         std::cout << "[INFO] Reading image: " << imagePath << std::endl;
-                        
-                        // Checking if the current image readable
-                        cv::Mat image = cv::imread(imagePath);
-                        if (image.empty()) {
-                            std::cerr << "Warning: Could not read image " << imagePath << std::endl;
-                            continue;
-                        }
-
-                        // Grayscales the image
-                        cv::Mat gray;
-                        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
 
-                        // Checks to see if a face can be recognized in the grayscaled image
-                        std::vector<cv::Rect> faces = detector.detectFaces(gray);
-                        if (faces.empty()) {
-                            std::cerr << "Warning: No face detected in " << imagePath << std::endl;
+                        // Grayscales the image and crops its face, the same way enrollment and recognition do
+                        cv::Mat faceResized;
+                        if (!FaceEnroller::cropFace(detector, preprocessor, imagePath, faceResized)) {
                             continue;
                         }
 
-                        // Resizes the image 
-                        cv::Mat faceROI = gray(faces[0]);
-                        cv::Mat faceResized;
-                        cv::resize(faceROI, faceResized, cv::Size(100, 100));
-
                         // Adds the edited image to the training dataset and assigns it a label
                         trainingImages.push_back(faceResized);
                         trainingLabels.push_back(labelID);
@@ -136,14 +136,54 @@ int training() {
     recognizer->save(modelPath);
     std::cout << "[INFO] Training complete. Model saved at " << modelPath << std::endl;
 
+    // Writes the compact gallery the recognition programs load instead of the model
+    LbphGallery gallery;
+    if (!gallery.build(*recognizer, kGalleryFormat) || !gallery.write(galleryPath)) {
+        return -1;
+    }
+    std::cout << "[INFO] Gallery saved at " << galleryPath << std::endl;
+
     return 0;
 }
 
 /**
- * @brief Calls the training function to train the model
+ * @brief Converts an OpenCV LBPH model into a binary gallery file
+ *
+ * @param modelPath embeddings.xml written by cv::face::LBPHFaceRecognizer::save.
+ * @param galleryPath Destination gallery.bin.
+ * @return int 0 upon success, -1 upon failure
+ */
+int convert(const std::string& modelPath, const std::string& galleryPath) {
+    // Same parameters as training, in case the file does not carry the threshold
+    cv::Ptr<cv::face::LBPHFaceRecognizer> recognizer = cv::face::LBPHFaceRecognizer::create(1, 10, 8, 8, 100.0);
+    try {
+        recognizer->read(modelPath);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error loading model: " << e.what() << std::endl;
+        return -1;
+    }
+    LbphGallery gallery;
+    if (!gallery.build(*recognizer, kGalleryFormat) || !gallery.write(galleryPath)) {
+        std::cerr << "Error: Unable to convert " << modelPath << std::endl;
+        return -1;
+    }
+    std::cout << "[INFO] Converted " << gallery.size() << " histogram(s) from " << modelPath << " to " << galleryPath
+              << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Calls the training function to train the model, or converts a model with --convert MODEL GALLERY
  * 
  * @return int 0 upon success, -1 upon failure
  */
-int main() {
-    training();
+int main(int argc, char* argv[]) {
+    if (argc == 4 && std::string(argv[1]) == "--convert") {
+        return convert(argv[2], argv[3]);
+    }
+    if (argc != 1) {
+        std::cerr << "Usage: " << argv[0] << " [--convert MODEL.xml GALLERY.bin]" << std::endl;
+        return -1;
+    }
+    return training();
 }
\ No newline at end of file
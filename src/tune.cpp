@@ -0,0 +1,346 @@
+/**
+ * @file tune.cpp
+ * @brief Sweeps the face detector's scan parameters over a labeled set of frames and writes the best ones to
+ *        detector.yml.
+ *
+ * Every combination of scaleFactor, minNeighbors, minSize and maxSize is run over all frames with the backend
+ * selected in detector.yml. For each combination the mean detection time per frame, the recall (annotated faces
+ * found with an overlap of at least 0.5) and the precision are measured. The combinations that no other one beats
+ * on both time and recall form the Pareto front, which is printed; the fastest front entry whose recall is within
+ * --recall-slack of the best recall is written back to detector.yml, which every program loads at startup. Only
+ * the four swept keys change; every other key and comment of the file is kept. The sweep applies to the haar and
+ * lbp cascades only, so the tool refuses to run with the dnn backend.
+ *
+ * The frames directory holds the images and a faces.csv with one "file,x,y,width,height" line per annotated face.
+ * Images without a line in faces.csv are treated as showing no face.
+ *
+ * Usage: OpenCVProjectTune --frames DIR [--config PATH] [--recall-slack R] [--dry-run]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "FaceDetector.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/// One image of the labeled set and the faces annotated in it
+struct LabeledFrame {
+    std::string file;
+    cv::Mat gray;
+    std::vector<cv::Rect> faces;
+};
+
+/// Measured quality and cost of one parameter combination
+struct SweepResult {
+    DetectionParams params;
+    double msPerFrame = 0.0;
+    double recall = 0.0;
+    double precision = 0.0;
+    bool pareto = false;
+};
+
+/// Intersection over union of two boxes
+double overlap(const cv::Rect& a, const cv::Rect& b) {
+    double intersection = (a & b).area();
+    double unionArea = a.area() + b.area() - intersection;
+    return unionArea > 0.0 ? intersection / unionArea : 0.0;
+}
+
+/// Load every image in the directory together with its annotations from faces.csv
+std::vector<LabeledFrame> loadLabeledFrames(const std::string& directory) {
+    std::map<std::string, std::vector<cv::Rect>> annotations;
+    std::ifstream csvFile(directory + "/faces.csv");
+    if (!csvFile.is_open()) {
+        std::cerr << "Error opening " << directory << "/faces.csv" << std::endl;
+        return {};
+    }
+    std::string line;
+    while (std::getline(csvFile, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::stringstream fields(line);
+        std::string file, value;
+        std::vector<int> numbers;
+        std::getline(fields, file, ',');
+        while (std::getline(fields, value, ',')) {
+            try {
+                numbers.push_back(std::stoi(value));
+            } catch (const std::exception&) {
+                break;
+            }
+        }
+        if (numbers.size() != 4) {
+            std::cerr << "Warning: Skipping annotation line: " << line << std::endl;
+            continue;
+        }
+        annotations[file].push_back(cv::Rect(numbers[0], numbers[1], numbers[2], numbers[3]));
+    }
+
+    std::vector<LabeledFrame> frames;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        std::string extension = entry.path().extension().string();
+        if (!entry.is_regular_file() || (extension != ".png" && extension != ".jpg" && extension != ".jpeg")) {
+            continue;
+        }
+        LabeledFrame frame;
+        frame.file = entry.path().filename().string();
+        frame.gray = cv::imread(entry.path().string(), cv::IMREAD_GRAYSCALE);
+        if (frame.gray.empty()) {
+            std::cerr << "Warning: Could not read image " << entry.path() << std::endl;
+            continue;
+        }
+        frame.faces = annotations[frame.file];
+        frames.push_back(frame);
+    }
+    std::sort(frames.begin(), frames.end(),
+              [](const LabeledFrame& a, const LabeledFrame& b) { return a.file < b.file; });
+    return frames;
+}
+
+/// Run the detector with one parameter combination over every frame
+SweepResult evaluate(FaceDetector& detector, const DetectionParams& params, const std::vector<LabeledFrame>& frames) {
+    SweepResult result;
+    result.params = params;
+    detector.setParams(params);
+
+    std::size_t annotated = 0, found = 0, reported = 0, correct = 0;
+    double totalMs = 0.0;
+    for (const auto& frame : frames) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<cv::Rect> detections = detector.detectFaces(frame.gray);
+        totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        annotated += frame.faces.size();
+        reported += detections.size();
+        for (const auto& face : frame.faces) {
+            if (std::any_of(detections.begin(), detections.end(),
+                            [&face](const cv::Rect& box) { return overlap(face, box) >= 0.5; })) {
+                found++;
+            }
+        }
+        for (const auto& box : detections) {
+            if (std::any_of(frame.faces.begin(), frame.faces.end(),
+                            [&box](const cv::Rect& face) { return overlap(face, box) >= 0.5; })) {
+                correct++;
+            }
+        }
+    }
+    result.msPerFrame = frames.empty() ? 0.0 : totalMs / frames.size();
+    result.recall = annotated ? static_cast<double>(found) / annotated : 1.0;
+    result.precision = reported ? static_cast<double>(correct) / reported : 1.0;
+    return result;
+}
+
+/// Mark the results that no other result beats on both time and recall
+void markParetoFront(std::vector<SweepResult>& results) {
+    for (auto& candidate : results) {
+        candidate.pareto = std::none_of(results.begin(), results.end(), [&candidate](const SweepResult& other) {
+            return other.msPerFrame <= candidate.msPerFrame && other.recall >= candidate.recall &&
+                   (other.msPerFrame < candidate.msPerFrame || other.recall > candidate.recall);
+        });
+    }
+}
+
+/// Print one result as a table row
+void printResult(const SweepResult& result) {
+    std::cout << std::fixed << std::setprecision(2) << std::setw(6) << result.params.scaleFactor << std::setw(5)
+              << result.params.minNeighbors << std::setw(6) << result.params.minSize.width << std::setw(6)
+              << result.params.maxSize.width << std::setw(10) << result.msPerFrame << std::setprecision(3)
+              << std::setw(9) << result.recall << std::setw(11) << result.precision << (result.pareto ? "  *" : "")
+              << std::endl;
+}
+
+/// Prefix of the comment lines the tool writes, so the next run can replace them
+const std::string kTuneComment = "# OpenCVProjectTune:";
+
+/// Rewrite detector.yml with the chosen parameters, keeping every other key and comment exactly as it is
+/**
+ * The file is edited as text: the lines of the four swept keys get their new values in place, missing ones are
+ * appended, and the Pareto front of the previous run is replaced by this run's. cv::FileStorage would drop the
+ * comments and any key this tool does not know.
+ */
+bool writeConfig(const std::string& configPath, const SweepResult& chosen, const std::vector<SweepResult>& front) {
+    std::vector<std::pair<std::string, std::string>> tuned;
+    auto value = [](auto number) {
+        std::ostringstream text;
+        text << number;
+        return text.str();
+    };
+    tuned.emplace_back("scaleFactor", value(chosen.params.scaleFactor));
+    tuned.emplace_back("minNeighbors", value(chosen.params.minNeighbors));
+    tuned.emplace_back("minSize", value(chosen.params.minSize.width));
+    tuned.emplace_back("maxSize", value(chosen.params.maxSize.width));
+
+    std::vector<std::string> lines;
+    std::ifstream existing(configPath);
+    std::string line;
+    while (std::getline(existing, line)) {
+        if (line.compare(0, kTuneComment.size(), kTuneComment) != 0) {
+            lines.push_back(line);
+        }
+    }
+    existing.close();
+    if (lines.empty()) {
+        lines = {"%YAML:1.0", "---"};
+    }
+    for (const auto& [key, number] : tuned) {
+        auto found = std::find_if(lines.begin(), lines.end(), [&key](const std::string& text) {
+            return text.compare(0, key.size() + 1, key + ":") == 0;
+        });
+        if (found != lines.end()) {
+            *found = key + ": " + number;
+        } else {
+            lines.push_back(key + ": " + number);
+        }
+    }
+    lines.push_back(kTuneComment + " Pareto front (scaleFactor minNeighbors minSize maxSize ms/frame recall)");
+    for (const auto& result : front) {
+        std::ostringstream row;
+        row << kTuneComment << " " << std::fixed << std::setprecision(2) << result.params.scaleFactor << " "
+            << result.params.minNeighbors << " " << result.params.minSize.width << " "
+            << result.params.maxSize.width << " " << result.msPerFrame << " " << std::setprecision(3)
+            << result.recall;
+        lines.push_back(row.str());
+    }
+
+    std::string temporary = configPath + ".tmp";
+    std::ofstream config(temporary, std::ios::trunc);
+    if (!config.is_open()) {
+        std::cerr << "Error: Unable to open " << temporary << " for writing." << std::endl;
+        return false;
+    }
+    for (const auto& text : lines) {
+        config << text << "\n";
+    }
+    config.close();
+    std::error_code error;
+    fs::rename(temporary, configPath, error);
+    if (!config || error) {
+        std::cerr << "Error: Unable to replace " << configPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
+
+/**
+ * @brief Parses the command line, runs the sweep and writes the chosen settings
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv --frames DIR is the labeled set, --config PATH the detector.yml to tune (default
+ *             textfiles/detector.yml), --recall-slack R how much recall may be traded for speed (default 0.02),
+ *             --dry-run prints the results without writing.
+ * @return int 0 upon success, -1 upon failure
+ */
+int main(int argc, char* argv[]) {
+    std::string root = PROJECT_ROOT_DIR;
+    std::string framesDir;
+    std::string configPath = root + "/textfiles/detector.yml";
+    double recallSlack = 0.02;
+    bool dryRun = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            framesDir = argv[++i];
+        } else if (arg == "--config" && i + 1 < argc) {
+            configPath = argv[++i];
+        } else if (arg == "--recall-slack" && i + 1 < argc) {
+            recallSlack = std::atof(argv[++i]);
+        } else if (arg == "--dry-run") {
+            dryRun = true;
+        } else {
+            framesDir.clear();
+            break;
+        }
+    }
+    if (framesDir.empty()) {
+        std::cerr << "Usage: " << argv[0] << " --frames DIR [--config PATH] [--recall-slack R] [--dry-run]" << std::endl;
+        return -1;
+    }
+
+    std::vector<LabeledFrame> frames = loadLabeledFrames(framesDir);
+    if (frames.empty()) {
+        std::cerr << "Error: No labeled frames in " << framesDir << std::endl;
+        return -1;
+    }
+
+    FaceDetector detector;
+    if (!detector.loadConfig(configPath, root)) {
+        return -1;
+    }
+    if (detector.backendName() == "dnn") {
+        // The sweep only varies the cascade's scan; the DNN backend has its own fixed input size and threshold
+        std::cerr << "Error: The dnn backend ignores scaleFactor and minNeighbors; tune a haar or lbp backend instead"
+                  << std::endl;
+        return -1;
+    }
+    DetectionParams base = detector.params();
+    std::cout << "[INFO] Tuning the " << detector.backendName() << " detector on " << frames.size() << " frames"
+              << std::endl;
+
+    // Warm up caches and the cascade's internal buffers so the first combination is not penalized
+    evaluate(detector, base, frames);
+
+    std::vector<SweepResult> results;
+    for (double scaleFactor : {1.05, 1.1, 1.2, 1.3, 1.4}) {
+        for (int minNeighbors : {3, 4, 5, 6}) {
+            for (int minSize : {40, 60, 80, 100}) {
+                for (int maxSize : {250, 350, 500}) {
+                    DetectionParams params = base;
+                    params.scaleFactor = scaleFactor;
+                    params.minNeighbors = minNeighbors;
+                    params.minSize = cv::Size(minSize, minSize);
+                    params.maxSize = cv::Size(maxSize, maxSize);
+                    results.push_back(evaluate(detector, params, frames));
+                }
+            }
+        }
+    }
+    markParetoFront(results);
+
+    std::sort(results.begin(), results.end(),
+              [](const SweepResult& a, const SweepResult& b) { return a.msPerFrame < b.msPerFrame; });
+    std::cout << " scale  nbr  min   max  ms/frame   recall  precision  (* = Pareto front)" << std::endl;
+    for (const auto& result : results) {
+        printResult(result);
+    }
+
+    std::vector<SweepResult> front;
+    double bestRecall = 0.0;
+    for (const auto& result : results) {
+        if (result.pareto) {
+            front.push_back(result);
+            bestRecall = std::max(bestRecall, result.recall);
+        }
+    }
+    // The front is sorted by time, so the first entry close enough to the best recall is the fastest acceptable one
+    auto chosen = std::find_if(front.begin(), front.end(), [&](const SweepResult& result) {
+        return result.recall >= bestRecall - recallSlack;
+    });
+    std::cout << "[INFO] Chosen:" << std::endl;
+    printResult(*chosen);
+
+    if (dryRun) {
+        return 0;
+    }
+    if (!writeConfig(configPath, *chosen, front)) {
+        return -1;
+    }
+    std::cout << "[INFO] Wrote " << configPath << std::endl;
+    return 0;
+}